@@ -0,0 +1,1028 @@
+#include "bios_image.hpp"
+#include "compression.hpp"
+#include "file_writer.hpp"
+#include "manager.hpp"
+#include "manager_serialize.hpp"
+#include "password_store.hpp"
+#include "persist_scheduler.hpp"
+#include "worker_pool.hpp"
+
+#include <malloc.h>
+#include <openssl/evp.h>
+#include <sys/socket.h>
+#include <systemd/sd-bus.h>
+#include <unistd.h>
+
+#include <benchmark/benchmark.h>
+#include <boost/asio/detached.hpp>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/spawn.hpp>
+#include <cereal/archives/binary.hpp>
+#include <cereal/types/map.hpp>
+#include <cereal/types/string.hpp>
+#include <cereal/types/tuple.hpp>
+#include <cereal/types/variant.hpp>
+#include <cereal/types/vector.hpp>
+#include <sdbusplus/asio/connection.hpp>
+#include <sdbusplus/asio/object_server.hpp>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <new>
+#include <string>
+#include <vector>
+
+// Count every heap allocation made by the process, and the heap it holds,
+// so that the benchmarks can report allocations per operation and memory use.
+static std::atomic<size_t> allocationCount{0};
+static std::atomic<size_t> liveHeapBytes{0};
+static std::atomic<size_t> peakHeapBytes{0};
+
+void* operator new(size_t size)
+{
+    void* ptr = std::malloc(size == 0 ? 1 : size);
+    if (ptr == nullptr)
+    {
+        throw std::bad_alloc();
+    }
+
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    const size_t usable = malloc_usable_size(ptr);
+    const size_t live =
+        liveHeapBytes.fetch_add(usable, std::memory_order_relaxed) + usable;
+    size_t peak = peakHeapBytes.load(std::memory_order_relaxed);
+    while (live > peak && !peakHeapBytes.compare_exchange_weak(
+                              peak, live, std::memory_order_relaxed))
+    {}
+    return ptr;
+}
+
+void operator delete(void* ptr) noexcept
+{
+    if (ptr != nullptr)
+    {
+        liveHeapBytes.fetch_sub(malloc_usable_size(ptr),
+                                std::memory_order_relaxed);
+    }
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, size_t /*size*/) noexcept
+{
+    operator delete(ptr);
+}
+
+namespace
+{
+
+using bios_config::Manager;
+using AttributeType = Manager::AttributeType;
+using BoundType = Manager::BoundType;
+
+constexpr size_t batchSize = 100;
+constexpr size_t maxSamples = 1 << 20;
+
+/** @brief Build a synthetic BaseBIOSTable. Half of the attributes are
+ *         enumerations with 2 to 16 options, a quarter are strings and a
+ *         quarter are integers; menu paths and option names repeat the way
+ *         they do in real BIOS tables.
+ */
+Manager::BaseTable makeTable(size_t count)
+{
+    static const std::array<std::string, 8> menus = {
+        "./SysMgmt/ProcessorSettings",   "./SysMgmt/MemorySettings",
+        "./SysMgmt/IntegratedDevices",   "./SysMgmt/SerialCommSettings",
+        "./SysMgmt/SystemProfileSettings", "./SysMgmt/SysSecurity",
+        "./SysMgmt/BootSettings",        "./SysMgmt/NetworkSettings",
+    };
+
+    Manager::BaseTable table;
+    for (size_t i = 0; i < count; i++)
+    {
+        auto name = "Attribute" + std::to_string(i);
+        auto menuPath =
+            menus[i % menus.size()] + "/Page" + std::to_string(i % 32);
+        std::vector<std::tuple<BoundType, std::variant<int64_t, std::string>,
+                               std::string>>
+            options;
+        AttributeType type{};
+        std::variant<int64_t, std::string> current;
+
+        switch (i % 4)
+        {
+            case 0:
+            case 1:
+                type = AttributeType::Enumeration;
+                for (size_t k = 0; k < 2 + i % 15; k++)
+                {
+                    options.emplace_back(BoundType::OneOf,
+                                         "Option" + std::to_string(k),
+                                         "Option " + std::to_string(k));
+                }
+                current = "Option0";
+                break;
+            case 2:
+                type = AttributeType::String;
+                options.emplace_back(BoundType::MinStringLength, 0, "");
+                options.emplace_back(BoundType::MaxStringLength, 32, "");
+                current = "value";
+                break;
+            default:
+                type = AttributeType::Integer;
+                options.emplace_back(BoundType::LowerBound, 0, "");
+                options.emplace_back(BoundType::UpperBound, 1000, "");
+                options.emplace_back(BoundType::ScalarIncrement, 1, "");
+                current = int64_t{0};
+                break;
+        }
+
+        table.emplace(name, std::make_tuple(
+                                type, false, "Display name of " + name,
+                                "Description of the " + name + " setting",
+                                menuPath, current, current, options));
+    }
+
+    return table;
+}
+
+/** @brief Pick a valid value for an attribute of the synthetic table.
+ */
+Manager::AttributeValue validValue(const Manager::BaseTable::value_type& attr,
+                                   size_t salt)
+{
+    const auto& [type, readOnly, displayName, description, menuPath, current,
+                 defaultValue, options] = attr.second;
+
+    switch (type)
+    {
+        case AttributeType::Enumeration:
+            return std::get<std::string>(
+                std::get<1>(options[salt % options.size()]));
+        case AttributeType::String:
+            return "value" + std::to_string(salt % 100);
+        default:
+            return static_cast<int64_t>(salt % 1000);
+    }
+}
+
+/** @class Daemon
+ *
+ *  @brief Manager served on a peer-to-peer bus whose other end lives in the
+ *         benchmark process, so that nothing touches the system bus.
+ */
+class Daemon
+{
+  public:
+    explicit Daemon(const Manager::BaseTable& table) :
+        persistPath(std::filesystem::temp_directory_path() /
+                    ("biosconfig-benchmark-" + std::to_string(getpid())))
+    {
+        std::filesystem::remove_all(persistPath);
+
+        std::array<int, 2> fds{};
+        if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0,
+                       fds.data()) != 0)
+        {
+            throw std::runtime_error("socketpair failed");
+        }
+
+        sd_id128_t id{};
+        sd_id128_randomize(&id);
+        sd_bus_new(&peer);
+        sd_bus_set_fd(peer, fds[0], fds[0]);
+        sd_bus_set_server(peer, 1, id);
+        sd_bus_start(peer);
+
+        sd_bus* bus = nullptr;
+        sd_bus_new(&bus);
+        sd_bus_set_fd(bus, fds[1], fds[1]);
+        sd_bus_start(bus);
+
+        connection = std::make_shared<sdbusplus::asio::connection>(io, bus);
+        objectServer =
+            std::make_unique<sdbusplus::asio::object_server>(connection);
+
+        metrics = std::make_unique<bios_config::Metrics>(*objectServer);
+
+        // Never flush on its own, the persistence paths are measured apart
+        scheduler = std::make_unique<bios_config::PersistScheduler>(
+            io, *objectServer, std::chrono::hours(1),
+            std::numeric_limits<size_t>::max(), *metrics);
+        manager = std::make_unique<Manager>(
+            *objectServer, connection, persistPath.string(), *scheduler,
+            *metrics);
+
+        manager->baseBIOSTable(table);
+        scheduler->sync();
+        drain();
+    }
+
+    ~Daemon()
+    {
+        scheduler->sync();
+        manager.reset();
+        scheduler.reset();
+        metrics.reset();
+        objectServer.reset();
+        connection.reset();
+        sd_bus_flush_close_unref(peer);
+        std::filesystem::remove_all(persistPath);
+    }
+
+    Daemon(const Daemon&) = delete;
+    Daemon& operator=(const Daemon&) = delete;
+    Daemon(Daemon&&) = delete;
+    Daemon& operator=(Daemon&&) = delete;
+
+    /** @brief Deliver the queued signals to the peer and discard them.
+     */
+    void drain()
+    {
+        while (sd_bus_process(connection->get(), nullptr) > 0 ||
+               sd_bus_process(peer, nullptr) > 0)
+        {}
+    }
+
+    std::filesystem::path biosFile() const
+    {
+        return persistPath / bios_config::biosPersistFile;
+    }
+
+    boost::asio::io_context io;
+    std::filesystem::path persistPath;
+    sd_bus* peer = nullptr;
+    std::shared_ptr<sdbusplus::asio::connection> connection;
+    std::unique_ptr<sdbusplus::asio::object_server> objectServer;
+    std::unique_ptr<bios_config::Metrics> metrics;
+    std::unique_ptr<bios_config::PersistScheduler> scheduler;
+    std::unique_ptr<Manager> manager;
+};
+
+/** @brief Run an operation once per benchmark iteration and report latency
+ *         percentiles, throughput and allocations per operation.
+ */
+template <typename Operation>
+void measure(benchmark::State& state, Operation&& operation,
+             size_t itemsPerOperation = 1)
+{
+    std::vector<int64_t> samples;
+    samples.reserve(std::min<size_t>(state.max_iterations, maxSamples));
+
+    const size_t allocationsBefore = allocationCount;
+    for (auto _ : state)
+    {
+        auto start = std::chrono::steady_clock::now();
+        operation();
+        auto end = std::chrono::steady_clock::now();
+
+        if (samples.size() < samples.capacity())
+        {
+            samples.push_back(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(end -
+                                                                     start)
+                    .count());
+        }
+    }
+    const size_t allocations = allocationCount - allocationsBefore;
+
+    state.SetItemsProcessed(
+        static_cast<int64_t>(state.iterations() * itemsPerOperation));
+    state.counters["allocs_per_op"] = benchmark::Counter(
+        static_cast<double>(allocations),
+        benchmark::Counter::kAvgIterations);
+
+    if (samples.empty())
+    {
+        return;
+    }
+
+    std::ranges::sort(samples);
+    auto percentile = [&samples](double p) {
+        return static_cast<double>(
+            samples[static_cast<size_t>(p * (samples.size() - 1))]);
+    };
+    state.counters["p50_ns"] = percentile(0.50);
+    state.counters["p90_ns"] = percentile(0.90);
+    state.counters["p99_ns"] = percentile(0.99);
+}
+
+void BM_GetAttribute(benchmark::State& state)
+{
+    auto table = makeTable(state.range(0));
+    Daemon daemon(table);
+    std::vector<std::string> names;
+    for (const auto& [name, attr] : table)
+    {
+        names.push_back(name);
+    }
+
+    size_t i = 0;
+    measure(state, [&]() {
+        benchmark::DoNotOptimize(
+            daemon.manager->getAttribute(names[i++ % names.size()]));
+    });
+}
+BENCHMARK(BM_GetAttribute)->RangeMultiplier(10)->Range(100, 50000);
+
+/** @brief Derive a key the way a password change does.
+ */
+void derivePasswordKey()
+{
+    std::array<unsigned char, 32> seed{};
+    std::array<unsigned char, 48> key{};
+    PKCS5_PBKDF2_HMAC("0penBmc", 8, seed.data(), seed.size(), 1000,
+                      EVP_sha384(), key.size(), key.data());
+}
+
+/** @brief GetAttribute while password changes keep deriving keys: none (0),
+ *         on the worker pool (1), or on the io context every 100 requests
+ *         as before the pool (2). The tail latency shows the stall.
+ */
+void BM_GetAttributeDuringPasswordChange(benchmark::State& state)
+{
+    auto table = makeTable(10000);
+    Daemon daemon(table);
+    std::vector<std::string> names;
+    for (const auto& [name, attr] : table)
+    {
+        names.push_back(name);
+    }
+
+    bios_config::WorkerPool workers(daemon.io, 1, 8);
+    std::function<void()> resubmit = [&]() {
+        workers.submit(derivePasswordKey, resubmit);
+    };
+    if (state.range(0) == 1)
+    {
+        resubmit();
+    }
+
+    size_t i = 0;
+    measure(state, [&]() {
+        if (state.range(0) == 2 && i % 100 == 0)
+        {
+            derivePasswordKey();
+        }
+        benchmark::DoNotOptimize(
+            daemon.manager->getAttribute(names[i++ % names.size()]));
+        daemon.io.poll();
+    });
+
+    resubmit = nullptr;
+    daemon.io.poll();
+}
+BENCHMARK(BM_GetAttributeDuringPasswordChange)->DenseRange(0, 2);
+
+/** @brief A password record with SHA384 hashes, as the BIOS provisions it.
+ */
+bios_config_pwd::PasswordRecord makePasswordRecord()
+{
+    bios_config_pwd::PasswordRecord record;
+    auto& params = record.params;
+    for (size_t i = 0; i < params.seed.size(); i++)
+    {
+        params.seed[i] = static_cast<uint8_t>(i * 7);
+    }
+    for (size_t i = 0; i < params.adminPwdHash.size(); i++)
+    {
+        params.userPwdHash[i] = static_cast<uint8_t>(i * 3);
+        params.adminPwdHash[i] = static_cast<uint8_t>(i * 5);
+    }
+    params.userKdf = {"SHA384", 1000, 0};
+    params.adminKdf = params.userKdf;
+    return record;
+}
+
+/** @brief The seed data file in the JSON format.
+ */
+std::string passwordJson(const bios_config_pwd::PasswordRecord& record)
+{
+    nlohmann::json document;
+    bios_config_pwd::password_store::toJson(record, document);
+    return document.dump(4);
+}
+
+/** @brief Read the password seed data from the JSON file (0) or the binary
+ *         store (1).
+ */
+void BM_PasswordStoreLoad(benchmark::State& state)
+{
+    auto record = makePasswordRecord();
+    const bool binary = state.range(0) == 1;
+    auto data = binary ? bios_config_pwd::password_store::encode(record)
+                       : passwordJson(record);
+    auto path = std::filesystem::temp_directory_path() /
+                ("biosconfig-benchmark-" + std::to_string(getpid()) + ".pwd");
+    bios_config::FileWriter::replaceFile(path, data);
+
+    measure(state, [&]() {
+        if (binary)
+        {
+            std::ifstream ifs(path, std::ios::binary);
+            std::string content((std::istreambuf_iterator<char>(ifs)),
+                                std::istreambuf_iterator<char>());
+            benchmark::DoNotOptimize(
+                bios_config_pwd::password_store::decode(content));
+        }
+        else
+        {
+            std::ifstream ifs(path);
+            benchmark::DoNotOptimize(bios_config_pwd::password_store::fromJson(
+                nlohmann::json::parse(ifs)));
+        }
+    });
+
+    state.counters["file_bytes"] = static_cast<double>(data.size());
+    std::filesystem::remove(path);
+}
+BENCHMARK(BM_PasswordStoreLoad)->DenseRange(0, 1);
+
+/** @brief Write the password seed data, replaced atomically and synced as
+ *         the writer thread does: the JSON file (0) or the binary store (1).
+ */
+void BM_PasswordStoreWrite(benchmark::State& state)
+{
+    auto record = makePasswordRecord();
+    const bool binary = state.range(0) == 1;
+    auto path = std::filesystem::temp_directory_path() /
+                ("biosconfig-benchmark-" + std::to_string(getpid()) + ".pwd");
+
+    size_t fileSize = 0;
+    measure(state, [&]() {
+        record.isAdminPwdChanged = !record.isAdminPwdChanged;
+        auto data = binary ? bios_config_pwd::password_store::encode(record)
+                           : passwordJson(record);
+        bios_config::FileWriter::replaceFile(path, data);
+        fileSize = data.size();
+    });
+
+    state.counters["file_bytes"] = static_cast<double>(fileSize);
+    std::filesystem::remove(path);
+}
+BENCHMARK(BM_PasswordStoreWrite)->DenseRange(0, 1);
+
+void BM_SetAttribute(benchmark::State& state)
+{
+    auto table = makeTable(state.range(0));
+    Daemon daemon(table);
+    std::vector<std::pair<std::string, Manager::AttributeValue>> changes;
+    for (const auto& attr : table)
+    {
+        changes.emplace_back(attr.first, validValue(attr, changes.size()));
+    }
+
+    size_t i = 0;
+    measure(state, [&]() {
+        const auto& [name, value] = changes[i++ % changes.size()];
+        daemon.manager->setAttribute(name, value);
+        daemon.drain();
+    });
+}
+BENCHMARK(BM_SetAttribute)->RangeMultiplier(10)->Range(100, 50000);
+
+/** @brief Prepare two alternating sets of changes to batchSize attributes,
+ *         so that every call carries values that are not pending yet.
+ */
+std::array<Manager::AttributeValues, 2> makeBatches(
+    const Manager::BaseTable& table)
+{
+    std::array<Manager::AttributeValues, 2> batches;
+    size_t salt = 0;
+    for (const auto& attr : table)
+    {
+        if (batches[0].size() == batchSize)
+        {
+            break;
+        }
+        batches[0].emplace(attr.first, validValue(attr, salt++));
+        batches[1].emplace(attr.first, validValue(attr, salt++));
+    }
+
+    return batches;
+}
+
+void BM_SetAttributeSingleCalls(benchmark::State& state)
+{
+    auto table = makeTable(state.range(0));
+    Daemon daemon(table);
+    auto batches = makeBatches(table);
+
+    size_t i = 0;
+    measure(
+        state,
+        [&]() {
+            for (const auto& [name, value] : batches[i++ % 2])
+            {
+                daemon.manager->setAttribute(name, value);
+            }
+            daemon.drain();
+        },
+        batchSize);
+}
+BENCHMARK(BM_SetAttributeSingleCalls)->RangeMultiplier(10)->Range(100, 50000);
+
+void BM_SetAttributesBatch(benchmark::State& state)
+{
+    auto table = makeTable(state.range(0));
+    Daemon daemon(table);
+    auto batches = makeBatches(table);
+
+    size_t i = 0;
+    measure(
+        state,
+        [&]() {
+            daemon.manager->setAttributes(batches[i++ % 2]);
+            daemon.drain();
+        },
+        batchSize);
+}
+BENCHMARK(BM_SetAttributesBatch)->RangeMultiplier(10)->Range(100, 50000);
+
+/** @brief Read a batch of attributes with one GetAttributes call, the work
+ *         that replaces batchSize GetAttribute round trips.
+ */
+void BM_GetAttributesBatch(benchmark::State& state)
+{
+    auto table = makeTable(state.range(0));
+    Daemon daemon(table);
+    std::vector<std::string> names;
+    for (const auto& [name, value] : makeBatches(table)[0])
+    {
+        names.push_back(name);
+    }
+
+    measure(
+        state,
+        [&]() {
+            benchmark::DoNotOptimize(daemon.manager->getAttributes(names));
+        },
+        names.size());
+}
+BENCHMARK(BM_GetAttributesBatch)->RangeMultiplier(10)->Range(100, 50000);
+
+/** @brief Read every attribute with one GetAttributes call.
+ */
+void BM_GetAttributesAll(benchmark::State& state)
+{
+    auto table = makeTable(state.range(0));
+    Daemon daemon(table);
+
+    measure(
+        state,
+        [&]() { benchmark::DoNotOptimize(daemon.manager->getAttributes({})); },
+        table.size());
+}
+BENCHMARK(BM_GetAttributesAll)->RangeMultiplier(10)->Range(100, 50000);
+
+/** @brief List a submenu holding only submenus (second argument 0), or a
+ *         page holding 1/32 of the attributes (1).
+ */
+void BM_GetMenu(benchmark::State& state)
+{
+    auto table = makeTable(state.range(0));
+    Daemon daemon(table);
+    std::string path = state.range(1) == 0
+                           ? "./SysMgmt/ProcessorSettings"
+                           : "./SysMgmt/ProcessorSettings/Page0";
+
+    measure(state,
+            [&]() { benchmark::DoNotOptimize(daemon.manager->getMenu(path)); });
+}
+BENCHMARK(BM_GetMenu)->ArgsProduct({{100, 1000, 10000, 50000}, {0, 1}});
+
+/** @brief Stream the whole BaseBIOSTable in pages of the second argument.
+ *         Each page starts with a binary search, so the cost per attribute
+ *         should not grow with the table.
+ */
+void BM_GetBaseTablePage(benchmark::State& state)
+{
+    auto table = makeTable(state.range(0));
+    Daemon daemon(table);
+    auto pageSize = static_cast<uint32_t>(state.range(1));
+
+    measure(
+        state,
+        [&]() {
+            std::string cursor;
+            do
+            {
+                auto page = daemon.manager->getBaseTablePage(cursor, pageSize);
+                cursor = std::move(std::get<1>(page));
+                benchmark::DoNotOptimize(page);
+            } while (!cursor.empty());
+        },
+        state.range(0));
+}
+BENCHMARK(BM_GetBaseTablePage)
+    ->ArgsProduct({{1000, 10000, 50000}, {64, 1024}});
+
+void BM_PendingAttributesValidation(benchmark::State& state)
+{
+    auto table = makeTable(state.range(0));
+    Daemon daemon(table);
+    std::array<Manager::PendingAttributes, 2> pending;
+    for (size_t b = 0; b < pending.size(); b++)
+    {
+        for (const auto& [name, value] : makeBatches(table)[b])
+        {
+            pending[b].emplace(name, std::make_tuple(
+                                         std::get<0>(table.at(name)), value));
+        }
+    }
+
+    size_t i = 0;
+    measure(
+        state,
+        [&]() {
+            daemon.manager->pendingAttributes(pending[i++ % 2]);
+            daemon.drain();
+        },
+        batchSize);
+}
+BENCHMARK(BM_PendingAttributesValidation)
+    ->RangeMultiplier(10)
+    ->Range(100, 50000);
+
+/** @brief Set one attribute of a 50000 attribute table under a growing
+ *         number of dependency rules. Only the rules reading the attribute
+ *         are evaluated, so the latency should not grow with the rules.
+ */
+void BM_DependencyUpdate(benchmark::State& state)
+{
+    auto table = makeTable(50000);
+    Daemon daemon(table);
+
+    // Each string attribute is read-only while the enumeration before it
+    // has its last option, and each integer is bounded by the next one.
+    std::string rules = "[";
+    for (int64_t i = 0; i < state.range(0); i++)
+    {
+        auto base = (i % 12500) * 4;
+        rules += (i == 0 ? "" : ",");
+        if (i % 2 == 0)
+        {
+            rules += R"({"Attribute":"Attribute)" + std::to_string(base + 2) +
+                     R"(","Effect":"ReadOnly","When":"Attribute)" +
+                     std::to_string(base) + R"(","Equals":"Option16"})";
+        }
+        else
+        {
+            rules += R"({"Attribute":"Attribute)" + std::to_string(base + 3) +
+                     R"(","Effect":"UpperBound","From":"Attribute)" +
+                     std::to_string((base + 7) % 50000) + R"("})";
+        }
+    }
+    rules += "]";
+    daemon.manager->setDependencies(rules);
+
+    std::array<Manager::AttributeValues, 2> values = {
+        Manager::AttributeValues{{"Attribute0", "Option1"}},
+        Manager::AttributeValues{{"Attribute0", "Option0"}}};
+    size_t i = 0;
+    measure(state, [&]() {
+        daemon.manager->setAttributes(values[i++ % 2]);
+        daemon.drain();
+    });
+}
+BENCHMARK(BM_DependencyUpdate)->Arg(0)->Arg(1000)->Arg(10000)->Arg(50000);
+
+void BM_Serialize(benchmark::State& state)
+{
+    auto table = makeTable(state.range(0));
+    Daemon daemon(table);
+    daemon.manager->setAttributes(makeBatches(table)[0]);
+    daemon.scheduler->sync();
+
+    measure(state, [&]() {
+        bios_config::serialize(*daemon.manager, daemon.biosFile());
+    });
+    state.SetBytesProcessed(static_cast<int64_t>(
+        state.iterations() * std::filesystem::file_size(daemon.biosFile())));
+}
+BENCHMARK(BM_Serialize)->RangeMultiplier(10)->Range(100, 50000);
+
+void BM_Deserialize(benchmark::State& state)
+{
+    auto table = makeTable(state.range(0));
+    Daemon daemon(table);
+    daemon.manager->setAttributes(makeBatches(table)[0]);
+    daemon.scheduler->sync();
+    bios_config::serialize(*daemon.manager, daemon.biosFile());
+
+    measure(state, [&]() {
+        benchmark::DoNotOptimize(
+            bios_config::deserialize(daemon.biosFile(), *daemon.manager));
+    });
+    state.SetBytesProcessed(static_cast<int64_t>(
+        state.iterations() * std::filesystem::file_size(daemon.biosFile())));
+}
+BENCHMARK(BM_Deserialize)->RangeMultiplier(10)->Range(100, 50000);
+
+/** @brief Time a commit of the BIOS settings on the io context, which only
+ *         encodes the state, against waiting until the writer thread has
+ *         synced it to the file (second argument 1).
+ */
+void BM_PersistCommit(benchmark::State& state)
+{
+    auto table = makeTable(state.range(0));
+    Daemon daemon(table);
+    auto batches = makeBatches(table);
+    const bool durable = state.range(1) != 0;
+
+    size_t i = 0;
+    measure(state, [&]() {
+        daemon.manager->setAttributes(batches[i++ % 2]);
+        if (durable)
+        {
+            daemon.scheduler->sync();
+        }
+        else
+        {
+            daemon.scheduler->flush();
+        }
+    });
+    daemon.scheduler->sync();
+}
+BENCHMARK(BM_PersistCommit)->ArgsProduct({{100, 10000, 50000}, {0, 1}});
+
+/** @brief Persist the synthetic table, with pending values for some of its
+ *         attributes, the way the daemon finds it when it starts.
+ *
+ *  @param[in] table - BaseBIOSTable
+ *  @param[in] cerealFormat - write the cereal snapshot used before the
+ *                            indexed image format
+ */
+std::filesystem::path writeSnapshot(const Manager::BaseTable& table,
+                                    bool cerealFormat)
+{
+    Manager::PendingAttributes pending;
+    for (const auto& [name, value] : makeBatches(table)[0])
+    {
+        pending.emplace(name,
+                        std::make_tuple(std::get<0>(table.at(name)), value));
+    }
+
+    auto path = std::filesystem::temp_directory_path() /
+                ("biosconfig-benchmark-" + std::to_string(getpid()) +
+                 (cerealFormat ? ".cereal" : ".image"));
+    std::ofstream os(path, std::ios::out | std::ios::binary);
+    if (cerealFormat)
+    {
+        // Class version of the Manager, followed by its two properties
+        cereal::BinaryOutputArchive oarchive(os);
+        oarchive(std::uint32_t{0}, table, pending);
+    }
+    else
+    {
+        auto image = bios_config::BiosImage::encode(table, pending);
+        os.write(image.data(), static_cast<std::streamsize>(image.size()));
+    }
+
+    return path;
+}
+
+/** @brief Load the cereal snapshot and build the attribute store, as the
+ *         Manager did at startup before the indexed image format, then answer
+ *         one GetAttribute lookup.
+ */
+void BM_StartupCereal(benchmark::State& state)
+{
+    auto table = makeTable(state.range(0));
+    auto path = writeSnapshot(table, true);
+    const auto& name = table.rbegin()->first;
+
+    size_t peak = 0;
+    measure(state, [&]() {
+        const size_t before = liveHeapBytes;
+        peakHeapBytes = before;
+
+        Manager::BaseTable baseTable;
+        Manager::PendingAttributes pending;
+        std::ifstream is(path, std::ios::in | std::ios::binary);
+        cereal::BinaryInputArchive iarchive(is);
+        std::uint32_t version = 0;
+        iarchive(version, baseTable, pending);
+
+        bios_config::AttributeStore store;
+        store.assign(baseTable);
+        benchmark::DoNotOptimize(store.find(name));
+        benchmark::DoNotOptimize(pending);
+
+        peak = std::max<size_t>(peak, peakHeapBytes - before);
+    });
+    state.counters["peak_heap_bytes"] = static_cast<double>(peak);
+    std::filesystem::remove(path);
+}
+BENCHMARK(BM_StartupCereal)->RangeMultiplier(10)->Range(100, 50000);
+
+/** @brief Map the indexed image, as the Manager does at startup, then answer
+ *         one GetAttribute lookup from it.
+ */
+void BM_StartupImage(benchmark::State& state)
+{
+    auto table = makeTable(state.range(0));
+    auto path = writeSnapshot(table, false);
+    const auto& name = table.rbegin()->first;
+
+    size_t peak = 0;
+    measure(state, [&]() {
+        const size_t before = liveHeapBytes;
+        peakHeapBytes = before;
+
+        auto image = bios_config::BiosImage::open(path);
+        benchmark::DoNotOptimize(image->find(name));
+
+        peak = std::max<size_t>(peak, peakHeapBytes - before);
+    });
+    state.counters["peak_heap_bytes"] = static_cast<double>(peak);
+    std::filesystem::remove(path);
+}
+BENCHMARK(BM_StartupImage)->RangeMultiplier(10)->Range(100, 50000);
+
+#ifdef ENABLE_PERSIST_COMPRESSION
+/** @brief Write a snapshot with the given zstd level (0 stores it
+ *         uncompressed), synced as the writer thread does, and load it back.
+ *         The average time spent in each step is reported, to weigh the
+ *         codec time against the I/O it saves.
+ */
+void BM_CompressedSnapshot(benchmark::State& state)
+{
+    auto table = makeTable(state.range(0));
+    const auto level = static_cast<int>(state.range(1));
+    auto image = bios_config::BiosImage::encode(table, {});
+    auto path = std::filesystem::temp_directory_path() /
+                ("biosconfig-benchmark-" + std::to_string(getpid()) + ".zst");
+    const auto& name = table.rbegin()->first;
+
+    using Clock = std::chrono::steady_clock;
+    Clock::duration compressTime{};
+    Clock::duration writeTime{};
+    Clock::duration loadTime{};
+    size_t fileSize = 0;
+    measure(state, [&]() {
+        auto start = Clock::now();
+        auto data = bios_config::compression::compress(image, level);
+        auto compressed = Clock::now();
+        bios_config::FileWriter::replaceFile(path, data);
+        auto written = Clock::now();
+        auto loaded = bios_config::BiosImage::open(path);
+        benchmark::DoNotOptimize(loaded->find(name));
+        loadTime += Clock::now() - written;
+        writeTime += written - compressed;
+        compressTime += compressed - start;
+        fileSize = data.size();
+    });
+
+    auto average = [&state](Clock::duration total) {
+        return benchmark::Counter(
+            static_cast<double>(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(total)
+                    .count()),
+            benchmark::Counter::kAvgIterations);
+    };
+    state.counters["compress_ns"] = average(compressTime);
+    state.counters["write_ns"] = average(writeTime);
+    state.counters["load_ns"] = average(loadTime);
+    state.counters["file_bytes"] = static_cast<double>(fileSize);
+    state.counters["ratio"] =
+        static_cast<double>(image.size()) / static_cast<double>(fileSize);
+    std::filesystem::remove(path);
+}
+BENCHMARK(BM_CompressedSnapshot)
+    ->ArgsProduct({{1000, 10000, 50000}, {0, 1, 3, 9}});
+#endif
+
+/** @brief GetAttributes of the whole table while SetAttribute calls keep
+ *         coming, answered on the io context (second argument 0) or on the
+ *         reader threads (1). On the io context a read waits for the write
+ *         before it and holds up the ones after it; with the readers the io
+ *         context keeps applying writes until the reply is ready, and
+ *         writes_per_read counts them.
+ */
+void BM_ReadsDuringWrites(benchmark::State& state)
+{
+    auto table = makeTable(state.range(0));
+    Daemon daemon(table);
+    auto& manager = *daemon.manager;
+    std::vector<std::pair<std::string, Manager::AttributeValue>> changes;
+    for (const auto& attr : table)
+    {
+        changes.emplace_back(attr.first, validValue(attr, changes.size()));
+    }
+
+    size_t writes = 0;
+    auto write = [&]() {
+        const auto& [name, value] = changes[writes++ % changes.size()];
+        manager.setAttribute(name, value);
+        daemon.drain();
+    };
+
+    measure(state, [&]() {
+        if (state.range(1) == 0)
+        {
+            write();
+            benchmark::DoNotOptimize(manager.getAttributes({}));
+            return;
+        }
+
+        bool done = false;
+        boost::asio::spawn(
+            daemon.io,
+            [&](boost::asio::yield_context yield) {
+                benchmark::DoNotOptimize(manager.getAttributes(yield, {}));
+                done = true;
+            },
+            boost::asio::detached);
+        while (!done)
+        {
+            write();
+            daemon.io.poll();
+        }
+    });
+    state.counters["writes_per_read"] = benchmark::Counter(
+        static_cast<double>(writes), benchmark::Counter::kAvgIterations);
+}
+BENCHMARK(BM_ReadsDuringWrites)
+    ->ArgsProduct({{1000, 50000}, {0, 1}})
+    ->UseRealTime();
+
+/** @brief Cost of timing a handler, which every D-Bus call pays.
+ */
+void BM_MetricsTimer(benchmark::State& state)
+{
+    Daemon daemon(makeTable(1));
+    auto& metrics = *daemon.metrics;
+
+    for (auto _ : state)
+    {
+        auto timer = metrics.time(bios_config::Metrics::Handler::getAttribute);
+        benchmark::ClobberMemory();
+    }
+}
+BENCHMARK(BM_MetricsTimer);
+
+/** @brief Heap held by a plain copy of the table, the way the Manager
+ *         stored attributes before the attribute store.
+ */
+void BM_TableCopyMemory(benchmark::State& state)
+{
+    auto table = makeTable(state.range(0));
+    size_t bytes = 0;
+    for (auto _ : state)
+    {
+        const size_t before = liveHeapBytes;
+        Manager::BaseTable copy = table;
+        bytes = liveHeapBytes - before;
+        benchmark::DoNotOptimize(copy);
+    }
+    state.counters["heap_bytes"] = static_cast<double>(bytes);
+}
+BENCHMARK(BM_TableCopyMemory)->Arg(10000);
+
+/** @brief Heap held by the attribute store for the same table.
+ */
+void BM_AttributeStoreMemory(benchmark::State& state)
+{
+    auto table = makeTable(state.range(0));
+    size_t bytes = 0;
+    for (auto _ : state)
+    {
+        const size_t before = liveHeapBytes;
+        bios_config::AttributeStore store;
+        store.assign(table);
+        bytes = liveHeapBytes - before;
+        benchmark::DoNotOptimize(store);
+    }
+    state.counters["heap_bytes"] = static_cast<double>(bytes);
+}
+BENCHMARK(BM_AttributeStoreMemory)->Arg(10000);
+
+/** @brief Heap held by a Manager serving the same table, everything it keeps
+ *         included, which is what the RSS of the daemon follows.
+ */
+void BM_ManagerMemory(benchmark::State& state)
+{
+    auto table = makeTable(state.range(0));
+    size_t bytes = 0;
+    for (auto _ : state)
+    {
+        const size_t before = liveHeapBytes;
+        Daemon daemon(table);
+        bytes = liveHeapBytes - before;
+        benchmark::DoNotOptimize(daemon.manager);
+    }
+    state.counters["heap_bytes"] = static_cast<double>(bytes);
+}
+BENCHMARK(BM_ManagerMemory)->Arg(10000);
+
+} // namespace
+
+BENCHMARK_MAIN();
@@ -0,0 +1,189 @@
+#pragma once
+
+#include "attribute_store.hpp"
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace bios_config
+{
+
+/** @class AttributeDependencies
+ *
+ *  @brief Rules making the state of a BIOS attribute depend on the value of
+ *         another one, evaluated incrementally.
+ *
+ *  A rule either makes its target read-only or hidden while the source
+ *  attribute has, or does not have, a given value, or takes a bound of its
+ *  integer target from the value of the source attribute. Rules only read
+ *  values and only change states, so a changed value affects the targets of
+ *  the rules reading it and nothing further. The rules are indexed by source
+ *  and by target: evaluating a change visits the rules reading the changed
+ *  attributes and the rules of their targets, whatever the number of rules.
+ */
+class AttributeDependencies
+{
+  public:
+    using Value = AttributeStore::Value;
+
+    /** @enum What a rule changes in the state of its target */
+    enum class Effect
+    {
+        readOnly,
+        hidden,
+        lowerBound,
+        upperBound,
+    };
+
+    /** @struct Rule
+     *
+     *  @brief A dependency of the target attribute on the source attribute.
+     *         readOnly and hidden apply while the value of the source equals
+     *         value, or differs from it when negate is set. The bounds take
+     *         the integer value of the source.
+     */
+    struct Rule
+    {
+        std::string target;
+        Effect effect;
+        std::string source;
+        std::optional<Value> value;
+        bool negate = false;
+    };
+
+    /** @struct State
+     *
+     *  @brief State of an attribute resulting from the rules targeting it.
+     */
+    struct State
+    {
+        bool readOnly = false;
+        bool hidden = false;
+        std::optional<int64_t> lowerBound;
+        std::optional<int64_t> upperBound;
+
+        bool operator==(const State&) const = default;
+    };
+
+    /** @brief Hash allowing lookups by std::string_view */
+    struct NameHash
+    {
+        using is_transparent = void;
+
+        size_t operator()(std::string_view name) const
+        {
+            return std::hash<std::string_view>{}(name);
+        }
+    };
+
+    /** @brief States of the constrained attributes, others are absent */
+    using States =
+        std::unordered_map<std::string, State, NameHash, std::equal_to<>>;
+
+    /** @brief Effective value of an attribute, the pending value if any,
+     *         nullptr if the attribute is not in the BaseBIOSTable.
+     */
+    using Lookup = std::function<const Value*(std::string_view)>;
+
+    /** @brief Parse rules from their JSON description, an array of objects
+     *         like
+     *         {"Attribute": "X", "Effect": "ReadOnly", "When": "Y",
+     *          "NotEquals": "Enabled"} or
+     *         {"Attribute": "Z", "Effect": "UpperBound", "From": "W"}.
+     *         "Hidden" takes the same condition as "ReadOnly" and
+     *         "LowerBound" the same source as "UpperBound".
+     *
+     *  @param[in] json - JSON description of the rules
+     *
+     *  @return The rules. Throws std::invalid_argument if the description
+     *          is malformed.
+     */
+    static std::vector<Rule> parse(std::string_view json);
+
+    /** @brief Replace the rules. The states are cleared until the next
+     *         evaluateAll.
+     *
+     *  @param[in] newRules - rules
+     */
+    void assign(std::vector<Rule> newRules);
+
+    /** @brief Evaluate the state of every attribute targeted by a rule.
+     *
+     *  @param[in] lookup - effective values of the attributes
+     */
+    void evaluateAll(const Lookup& lookup);
+
+    /** @brief Evaluate the attributes affected by changed values, without
+     *         applying the result.
+     *
+     *  @param[in] changed - names of the attributes whose value changed
+     *  @param[in] lookup - effective values of the attributes, including
+     *                      the changed ones
+     *
+     *  @return New states of the targets of the rules reading any of the
+     *          changed attributes.
+     */
+    std::map<std::string, State>
+        evaluate(const std::vector<std::string_view>& changed,
+                 const Lookup& lookup) const;
+
+    /** @brief Apply states returned by evaluate. The ones equal to the
+     *         current states are skipped, so an evaluation that changes
+     *         nothing costs no copy.
+     *
+     *  @param[in] newStates - states returned by evaluate
+     *  @param[in] ownSnapshot - whether the latest snapshot holds the
+     *                           states and no reader holds that snapshot.
+     *                           The states are changed in place when
+     *                           nothing else holds them, else a copy is.
+     */
+    void commit(std::map<std::string, State> newStates, bool ownSnapshot);
+
+    /** @brief State of an attribute.
+     *
+     *  @return nullptr if no rule constrains the attribute
+     */
+    const State* state(std::string_view name) const;
+
+    /** @brief The states, to publish with a snapshot. The ones handed out
+     *         are only changed in place once no reader can see them, see
+     *         commit.
+     */
+    std::shared_ptr<const States> shared() const
+    {
+        return states;
+    }
+
+    /** @brief Number of rules.
+     */
+    size_t size() const
+    {
+        return rules.size();
+    }
+
+  private:
+    using Index = std::unordered_map<std::string, std::vector<size_t>,
+                                     NameHash, std::equal_to<>>;
+
+    /** @brief Fold the rules targeting an attribute into its state.
+     */
+    State evaluateTarget(const std::vector<size_t>& targetRules,
+                         const Lookup& lookup) const;
+
+    std::vector<Rule> rules;
+
+    /** @brief Rules by source and by target attribute */
+    Index bySource;
+    Index byTarget;
+
+    std::shared_ptr<States> states = std::make_shared<States>();
+};
+
+} // namespace bios_config
@@ -0,0 +1,193 @@
+#pragma once
+
+#include "attribute_dependencies.hpp"
+#include "attribute_store.hpp"
+#include "bios_image.hpp"
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace bios_config
+{
+
+/** @struct AttributeSnapshot
+ *
+ *  @brief Immutable state of the BIOS attributes at one generation.
+ *
+ *  Consecutive snapshots share what did not change between them; a change
+ *  of the pending values keeps the table of the previous snapshot.
+ *  Attributes hidden by a dependency are left out of everything a snapshot
+ *  lists, only find and state answer for them.
+ */
+struct AttributeSnapshot
+{
+    using Lookup = BiosImage::Lookup;
+    using Visitor = BiosImage::Visitor;
+    using BaseTable = AttributeStore::BaseTable;
+    using PendingAttributes = AttributeStore::PendingAttributes;
+
+    /** @brief Incremented by every published snapshot */
+    uint64_t generation = 0;
+
+    /** @brief Incremented by every snapshot publishing a new BaseBIOSTable
+     */
+    uint64_t tableGeneration = 0;
+
+    /** @brief Mapped image the attributes are read from until they are
+     *         materialized, table and pending are empty meanwhile.
+     */
+    std::shared_ptr<const BiosImage> image;
+
+    /** @brief BaseBIOSTable, never changed once published */
+    std::shared_ptr<const AttributeStore> table;
+
+    /** @brief PendingAttributes, the only copy the daemon holds */
+    std::shared_ptr<const AttributeStore::PendingAttributes> pending;
+
+    /** @brief States the dependencies put the attributes in, nullptr if
+     *         there are none
+     */
+    std::shared_ptr<const AttributeDependencies::States> states;
+
+    /** @struct State
+     *
+     *  @brief Whether an attribute is read-only and hidden, and its bounds,
+     *         with the dependencies applied. The bounds are 0 unless the
+     *         attribute is an integer.
+     */
+    struct State
+    {
+        bool readOnly = false;
+        bool hidden = false;
+        int64_t lowerBound = 0;
+        int64_t upperBound = 0;
+    };
+
+    /** @brief Find an attribute.
+     *
+     *  @param[in] name - attribute name
+     *
+     *  @return Type, current value and pending value of the attribute,
+     *          nullopt if it is not in the BaseBIOSTable.
+     */
+    std::optional<Lookup> find(const std::string& name) const;
+
+    /** @brief State of an attribute.
+     *
+     *  @param[in] name - attribute name
+     *
+     *  @return The state, nullopt if the attribute is not in the
+     *          BaseBIOSTable.
+     */
+    std::optional<State> state(const std::string& name) const;
+
+    /** @brief Check whether a dependency hides an attribute.
+     */
+    bool hidden(std::string_view name) const;
+
+    /** @brief Visit every attribute that is not hidden in name order, in a
+     *         single pass over the table and the pending values.
+     *
+     *  @param[in] visit - called for each attribute
+     */
+    void forEach(const Visitor& visit) const;
+
+    /** @brief Slice of the BaseBIOSTable in name order, without the hidden
+     *         attributes.
+     *
+     *  @param[in] after - the slice starts with the first attribute whose
+     *                     name sorts after this one, at the first attribute
+     *                     if empty
+     *  @param[in] limit - largest number of attributes in the slice
+     */
+    BaseTable tableSlice(std::string_view after, size_t limit) const;
+
+    /** @brief Slice of the PendingAttributes in name order, without the
+     *         hidden attributes.
+     *
+     *  @param[in] after - as for tableSlice
+     *  @param[in] limit - largest number of attributes in the slice
+     */
+    PendingAttributes pendingSlice(std::string_view after,
+                                   size_t limit) const;
+};
+
+/** @class SnapshotPublisher
+ *
+ *  @brief Publishes the attribute snapshots the reads are answered from.
+ *
+ *  The io context thread is the only one that publishes snapshots and takes
+ *  the latest one. A read run on a reader thread is handed the snapshot with
+ *  its job and keeps it for as long as it runs, so taking a snapshot is a
+ *  reference count increment, without any lock, and the snapshot is freed
+ *  once the last reader lets go of it.
+ */
+class SnapshotPublisher
+{
+  public:
+    using PendingAttributes = AttributeStore::PendingAttributes;
+
+    /** @brief The latest snapshot, to hand to a reader.
+     */
+    std::shared_ptr<const AttributeSnapshot> current() const
+    {
+        return snapshot;
+    }
+
+    /** @brief The latest snapshot, for the writer to look at.
+     */
+    const AttributeSnapshot& latest() const
+    {
+        return *snapshot;
+    }
+
+    /** @brief PendingAttributes to change for the next snapshot. They are
+     *         the ones of the latest snapshot, changed in place when no
+     *         reader holds them, else a copy of them.
+     */
+    std::shared_ptr<PendingAttributes> editPending();
+
+    /** @brief Whether the latest snapshot holds the states and no reader
+     *         holds that snapshot, see AttributeDependencies::commit.
+     */
+    bool ownsStates(
+        const std::shared_ptr<const AttributeDependencies::States>& states)
+        const
+    {
+        return snapshot.use_count() == 1 && snapshot->states == states;
+    }
+
+    /** @brief Publish the next snapshot.
+     *
+     *  @param[in] image - mapped image, if the attributes are served from it
+     *  @param[in] table - BaseBIOSTable
+     *  @param[in] pending - PendingAttributes, not changed any more unless
+     *                       through editPending
+     *  @param[in] states - states of the dependencies
+     *  @param[in] newTable - whether the BaseBIOSTable differs from the one
+     *                        of the previous snapshot
+     */
+    void publish(
+        std::shared_ptr<const BiosImage> image,
+        std::shared_ptr<const AttributeStore> table,
+        std::shared_ptr<PendingAttributes> pending,
+        std::shared_ptr<const AttributeDependencies::States> states,
+        bool newTable);
+
+    /** @brief Publish the latest snapshot again with new states of the
+     *         dependencies. The attributes and the generations stay.
+     */
+    void publishStates(
+        std::shared_ptr<const AttributeDependencies::States> states);
+
+  private:
+    std::shared_ptr<const AttributeSnapshot> snapshot =
+        std::make_shared<const AttributeSnapshot>();
+    uint64_t generation = 0;
+    uint64_t tableGeneration = 0;
+};
+
+} // namespace bios_config
@@ -0,0 +1,222 @@
+#pragma once
+
+#include "menu_index.hpp"
+#include "string_pool.hpp"
+
+#include <xyz/openbmc_project/BIOSConfig/Manager/server.hpp>
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <variant>
+#include <vector>
+
+namespace bios_config
+{
+
+/** @class AttributeStore
+ *
+ *  @brief Indexed in-memory copy of the BaseBIOSTable.
+ *
+ *  Every BIOS attribute is held once and is reachable through an
+ *  open-addressing hash index over the attribute names. A lookup is a single
+ *  probe sequence and does not allocate, unlike the by-value property
+ *  getters of the generated D-Bus server class. The strings repeated across
+ *  attributes are interned in a shared pool. Nothing changes a store after
+ *  assign, so a store shared with reader threads is never written again.
+ */
+class AttributeStore
+{
+  public:
+    using Interface = sdbusplus::xyz::openbmc_project::BIOSConfig::server::
+        Manager;
+    using AttributeType = Interface::AttributeType;
+    using BoundType = Interface::BoundType;
+    using Value = std::variant<int64_t, std::string>;
+    using Option = std::tuple<BoundType, Value, std::string>;
+    using Attribute =
+        std::tuple<AttributeType, bool, std::string, std::string, std::string,
+                   Value, Value, std::vector<Option>>;
+    using BaseTable = std::map<std::string, Attribute>;
+    using PendingAttribute = std::tuple<AttributeType, Value>;
+    using PendingAttributes = std::map<std::string, PendingAttribute>;
+
+    /** @struct Constraint
+     *
+     *  @brief Bounds of an attribute compiled from its BaseBIOSTable options
+     *         when the table is assigned.
+     */
+    struct Constraint
+    {
+        int64_t lowerBound = 0;
+        int64_t upperBound = 0;
+        int64_t scalarIncrement = 0;
+        size_t minStringLength = 0;
+        size_t maxStringLength = 0;
+
+        /** @brief Interned OneOf values, sorted */
+        std::vector<StringId> oneOf;
+    };
+
+    /** @struct StoredOption
+     *
+     *  @brief An option of a BIOS attribute with its strings interned.
+     */
+    struct StoredOption
+    {
+        BoundType boundType;
+        std::variant<int64_t, StringId> value;
+        StringId valueName;
+    };
+
+    /** @struct Entry
+     *
+     *  @brief A BIOS attribute and its compiled bounds. Display name,
+     *         description, menu path and option strings are held in the
+     *         string pool of the store.
+     */
+    struct Entry
+    {
+        std::string name;
+        AttributeType type;
+        bool readOnly;
+        StringId displayName;
+        StringId description;
+        StringId menuPath;
+        Value currentValue;
+        Value defaultValue;
+        std::vector<StoredOption> options;
+        Constraint constraint;
+    };
+
+    /** @struct TableDiff
+     *
+     *  @brief Names of the attributes that differ between two tables.
+     */
+    struct TableDiff
+    {
+        std::vector<std::string> added;
+        std::vector<std::string> removed;
+        std::vector<std::string> changed;
+
+        bool empty() const
+        {
+            return added.empty() && removed.empty() && changed.empty();
+        }
+    };
+
+    /** @brief Compare the attributes in the store with a new table.
+     *
+     *  @param[in] table - new BaseBIOSTable
+     *
+     *  @return Attributes added, removed and changed by the new table, in
+     *          name order.
+     */
+    TableDiff diff(const BaseTable& table) const;
+
+    /** @brief Check whether two definitions of an attribute are the same,
+     *         ignoring the current value.
+     *
+     *  @param[in] entry - attribute entry
+     *  @param[in] attribute - BaseBIOSTable entry of the attribute
+     */
+    bool sameDefinition(const Entry& entry, const Attribute& attribute) const;
+
+    /** @brief Check whether a value is one of the enumeration options of an
+     *         attribute.
+     *
+     *  @param[in] entry - attribute entry
+     *  @param[in] value - value to check
+     */
+    bool isOneOf(const Entry& entry, std::string_view value) const;
+
+    /** @brief Build the BaseBIOSTable entry of an attribute.
+     *
+     *  @param[in] entry - attribute entry
+     */
+    Attribute attribute(const Entry& entry) const;
+
+    /** @brief Pool holding the strings of the attributes.
+     */
+    const StringPool& strings() const
+    {
+        return pool;
+    }
+
+    /** @brief Replace the content of the store.
+     *
+     *  @param[in] table - new BaseBIOSTable
+     */
+    void assign(const BaseTable& table);
+
+    /** @brief Look up an attribute by name.
+     *
+     *  @param[in] name - attribute name
+     *
+     *  @return Pointer to the entry, nullptr if the attribute is not present
+     */
+    const Entry* find(std::string_view name) const;
+
+    /** @brief Position of an entry in all().
+     *
+     *  @param[in] entry - entry of this store
+     */
+    size_t index(const Entry& entry) const
+    {
+        return static_cast<size_t>(&entry - entries.data());
+    }
+
+    /** @brief Build the BaseBIOSTable property value from the store.
+     */
+    BaseTable baseTable() const;
+
+    /** @brief Submenus of the table, built by assign. The attribute
+     *         indices refer to all().
+     */
+    const MenuIndex& menus() const
+    {
+        return menuIndex;
+    }
+
+    /** @brief Attributes in name order.
+     */
+    const std::vector<Entry>& all() const
+    {
+        return entries;
+    }
+
+    /** @brief Number of attributes in the store.
+     */
+    size_t size() const
+    {
+        return entries.size();
+    }
+
+  private:
+    static constexpr uint32_t emptySlot = UINT32_MAX;
+
+    /** @brief Build the entry of an attribute, interning its strings.
+     */
+    Entry makeEntry(const std::string& name, const Attribute& attribute);
+
+    /** @brief Compile the options of an attribute into its bounds.
+     */
+    static Constraint compile(const std::string& name,
+                              const std::vector<StoredOption>& options);
+
+    /** @brief Locate the index slot of an attribute name.
+     *
+     *  @return The slot holding the name, or the empty slot that ends its
+     *          probe sequence.
+     */
+    size_t probe(std::string_view name) const;
+
+    StringPool pool;
+    std::vector<Entry> entries;
+    std::vector<uint32_t> slots;
+    MenuIndex menuIndex;
+};
+
+} // namespace bios_config
@@ -0,0 +1,228 @@
+#pragma once
+
+#include "attribute_store.hpp"
+
+#include <array>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+
+namespace bios_config
+{
+
+/** @class BiosImage
+ *
+ *  @brief Memory-mapped view of the persisted BaseBIOSTable and
+ *         PendingAttributes in the indexed on-disk format.
+ *
+ *  The image starts with a versioned header locating its sections: the
+ *  attribute records sorted by name, the options of the attributes, the
+ *  pending attributes sorted by name and a section holding every distinct
+ *  string once. Records refer to strings by offset and length, so an
+ *  attribute is found with a binary search over the mapped file and is read
+ *  in place, without decoding the rest of the table. The image is written in
+ *  host byte order; the file never leaves the BMC.
+ *
+ *  Journal records appended after the image are exposed as raw bytes.
+ *  An image that was persisted in a compressed container is decompressed
+ *  into memory, along with the journal, instead of being mapped.
+ */
+class BiosImage
+{
+  public:
+    using AttributeType = AttributeStore::AttributeType;
+    using Value = AttributeStore::Value;
+    using Attribute = AttributeStore::Attribute;
+    using BaseTable = AttributeStore::BaseTable;
+    using PendingAttribute = AttributeStore::PendingAttribute;
+    using PendingAttributes = AttributeStore::PendingAttributes;
+
+    static constexpr std::array<char, 8> magic = {'B', 'I', 'O', 'S',
+                                                  'I', 'M', 'G', '\0'};
+    static constexpr uint32_t version = 1;
+
+    /** @struct Lookup
+     *
+     *  @brief The fields of an attribute that GetAttribute reports.
+     */
+    struct Lookup
+    {
+        AttributeType type;
+        Value currentValue;
+        std::optional<PendingAttribute> pending;
+    };
+
+    /** @brief Called with the name and the fields of each attribute */
+    using Visitor = std::function<void(std::string_view, Lookup)>;
+
+    BiosImage() = delete;
+    ~BiosImage();
+    BiosImage(const BiosImage&) = delete;
+    BiosImage& operator=(const BiosImage&) = delete;
+    BiosImage(BiosImage&&) = delete;
+    BiosImage& operator=(BiosImage&&) = delete;
+
+    /** @brief Map a persisted file, decompressing it if needed, and check
+     *         its image.
+     *
+     *  @param[in] path - path to the persisted file
+     *
+     *  @return The mapped image, nullptr if the file does not start with an
+     *          image, e.g. because it was written in the cereal format.
+     *          Throws std::runtime_error if the image is corrupted.
+     */
+    static std::unique_ptr<BiosImage> open(const std::filesystem::path& path);
+
+    /** @brief Encode an image.
+     *
+     *  @param[in] table - BaseBIOSTable
+     *  @param[in] pending - PendingAttributes
+     *
+     *  @return The encoded image
+     */
+    static std::string encode(const BaseTable& table,
+                              const PendingAttributes& pending);
+
+    /** @brief Find an attribute in the image.
+     *
+     *  @param[in] name - attribute name
+     *
+     *  @return Type, current value and pending value of the attribute,
+     *          nullopt if it is not in the BaseBIOSTable.
+     */
+    std::optional<Lookup> find(std::string_view name) const;
+
+    /** @brief Decode the BaseBIOSTable entry of an attribute.
+     *
+     *  @param[in] name - attribute name
+     *
+     *  @return The entry, nullopt if the attribute is not in the
+     *          BaseBIOSTable.
+     */
+    std::optional<Attribute> attribute(std::string_view name) const;
+
+    /** @brief Visit every attribute in name order, in a single pass over
+     *         the attributes and the pending attributes.
+     *
+     *  @param[in] visit - called for each attribute
+     */
+    void forEach(const Visitor& visit) const;
+
+    /** @brief Decode the BaseBIOSTable, or a slice of it in name order.
+     *
+     *  @param[in] after - the slice starts with the first attribute whose
+     *                     name sorts after this one, at the first attribute
+     *                     if empty
+     *  @param[in] limit - largest number of attributes in the slice
+     */
+    BaseTable baseTable(std::string_view after = {},
+                        size_t limit = SIZE_MAX) const;
+
+    /** @brief Decode the PendingAttributes, or a slice of it in name order.
+     *
+     *  @param[in] after - as for baseTable
+     *  @param[in] limit - largest number of attributes in the slice
+     */
+    PendingAttributes pendingAttributes(std::string_view after = {},
+                                        size_t limit = SIZE_MAX) const;
+
+    /** @brief Number of attributes in the BaseBIOSTable.
+     */
+    size_t size() const;
+
+    /** @brief Number of attributes in the PendingAttributes.
+     */
+    size_t pendingCount() const;
+
+    /** @brief Bytes that follow the image in the file.
+     */
+    std::span<const char> journal() const
+    {
+        return {data + imageSize, fileSize - imageSize};
+    }
+
+  private:
+    struct Header;
+    struct StringRef;
+    struct ValueRecord;
+    struct AttributeRecord;
+    struct OptionRecord;
+    struct PendingRecord;
+
+    /** @brief Offset and number of records of a section of the image */
+    struct Section
+    {
+        size_t offset = 0;
+        size_t count = 0;
+    };
+
+    BiosImage(const char* data, size_t fileSize) :
+        data(data), fileSize(fileSize)
+    {}
+
+    explicit BiosImage(std::string decompressed) :
+        buffer(std::move(decompressed)), data(buffer.data()),
+        fileSize(buffer.size())
+    {}
+
+    /** @brief Read the header and check that every section and string
+     *         reference lies within the image, that the attribute and bound
+     *         types are known and that the names are sorted. Throws
+     *         std::runtime_error otherwise.
+     */
+    void validate();
+
+    /** @brief Copy a record out of a section.
+     */
+    template <typename Record>
+    Record read(const Section& section, size_t index) const;
+
+    /** @brief Index of the first record whose name does not sort before
+     *         the given one in a section sorted by name.
+     */
+    size_t lowerBound(const Section& section, size_t recordSize,
+                      std::string_view name) const;
+
+    /** @brief Index of the first record of a slice starting after a name,
+     *         see baseTable.
+     */
+    size_t sliceStart(const Section& section, size_t recordSize,
+                      std::string_view after) const;
+
+    /** @brief Index of the record with the given name in a section sorted
+     *         by name, found by binary search.
+     */
+    std::optional<size_t> search(const Section& section, size_t recordSize,
+                                 std::string_view name) const;
+
+    /** @brief Name of a record of either kind, see encode.
+     */
+    std::string_view nameAt(const Section& section, size_t recordSize,
+                            size_t index) const;
+
+    /** @brief Decode an attribute record into its BaseBIOSTable entry.
+     */
+    Attribute decode(const AttributeRecord& record) const;
+
+    bool contains(const StringRef& ref) const;
+    std::string_view string(const StringRef& ref) const;
+    Value value(const ValueRecord& record) const;
+
+    /** @brief Content of a decompressed file, empty if the file is mapped */
+    std::string buffer;
+    const char* data;
+    size_t fileSize;
+    size_t imageSize = 0;
+
+    Section attributes;
+    Section options;
+    Section pending;
+    Section strings;
+};
+
+} // namespace bios_config
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+namespace bios_config::compression
+{
+
+/** @brief First bytes of a persisted file holding a compressed payload.
+ *
+ *  The container is a header with the codec and both sizes, followed by
+ *  the compressed payload. Anything written after the container, like the
+ *  journal records that follow a BIOS image, is stored as it is. Files that
+ *  do not start with the magic are uncompressed payloads, so files written
+ *  before compression was enabled, or with compression disabled, load the
+ *  same way.
+ */
+static constexpr std::array<char, 8> magic = {'B', 'I', 'O', 'S',
+                                              'Z', 'S', 'T', '\0'};
+
+/** @enum Codecs a container may be written with */
+enum class Codec : uint32_t
+{
+    zstd = 1,
+};
+
+/** @brief Payloads smaller than this are stored uncompressed, the frame
+ *         overhead would outweigh the saving.
+ */
+constexpr size_t minPayloadSize = 256;
+
+#ifdef ENABLE_PERSIST_COMPRESSION
+
+/** @brief Compress a payload into a container with the configured level and
+ *         dictionary.
+ *
+ *  @param[in] payload - encoded state to persist
+ *  @param[in] level - zstd compression level, 0 stores the payload as it is
+ *
+ *  @return The container, or the payload itself if compression is disabled,
+ *          the payload is small or does not compress.
+ */
+std::string compress(std::string_view payload,
+                     int level = PERSIST_COMPRESSION_LEVEL);
+
+/** @brief Check whether persisted data starts with a container.
+ */
+bool isCompressed(std::span<const char> data);
+
+/** @brief Decompress the container at the start of persisted data.
+ *
+ *  @param[in] data - persisted data starting with a container
+ *
+ *  @return The payload followed by the bytes that follow the container.
+ *          Throws std::runtime_error if the container is corrupted or was
+ *          written with a dictionary that is not available.
+ */
+std::string decompress(std::span<const char> data);
+
+/** @brief Identifier of the configured dictionary, 0 if there is none.
+ */
+uint32_t dictionaryId();
+
+#else
+
+// Built without zstd: payloads are stored as they are, and containers
+// written by a build with compression are recognized but cannot be read.
+
+inline std::string compress(std::string_view payload,
+                            int /*level*/ = PERSIST_COMPRESSION_LEVEL)
+{
+    return std::string(payload);
+}
+
+inline bool isCompressed(std::span<const char> data)
+{
+    return data.size() >= magic.size() &&
+           std::equal(magic.begin(), magic.end(), data.begin());
+}
+
+inline std::string decompress(std::span<const char> /*data*/)
+{
+    throw std::runtime_error(
+        "Compressed container, but built without compression");
+}
+
+inline uint32_t dictionaryId()
+{
+    return 0;
+}
+
+#endif
+
+} // namespace bios_config::compression
@@ -0,0 +1,179 @@
+#pragma once
+
+#include "metrics.hpp"
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/posix/stream_descriptor.hpp>
+
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace bios_config
+{
+
+/** @class FileWriter
+ *
+ *  @brief Writes encoded state to persistent storage on a dedicated thread.
+ *
+ *  Objects encode their state on the io_context and hand the buffer over;
+ *  the open, write, fsync and rename calls run on the writer thread, so a
+ *  slow flash filesystem never blocks the D-Bus handlers. Requests are
+ *  filled into one buffer while the thread writes out the other, the two
+ *  are swapped whenever the thread runs out of work. The completion of a
+ *  request is reported back on the io_context.
+ *
+ *  Ordering and durability:
+ *  - Requests are written in the order they were submitted.
+ *  - A file is replaced by writing and syncing a temporary file next to it
+ *    and renaming it over the file, then syncing the directory. A crash
+ *    leaves either the old or the new content, never a mix.
+ *  - Appended data is synced before the request completes. A crash while
+ *    appending leaves a truncated record at the end of the file.
+ *  - A completion reporting success means the data is on stable storage.
+ *    Requests that have not completed when the process dies may be lost.
+ *  - Replacing a file supersedes the requests for the same file that the
+ *    thread has not picked up yet; their completions report the result of
+ *    the replacement.
+ *  - Once a write to a file fails, appends to it fail without being written
+ *    until a replacement of the file succeeds, so that appended data never
+ *    follows a replacement that did not happen or a record cut short.
+ */
+class FileWriter
+{
+  public:
+    using Done = std::function<void(bool)>;
+
+    FileWriter() = delete;
+    FileWriter(const FileWriter&) = delete;
+    FileWriter& operator=(const FileWriter&) = delete;
+    FileWriter(FileWriter&&) = delete;
+    FileWriter& operator=(FileWriter&&) = delete;
+
+    /** @brief Constructs FileWriter object and starts the writer thread.
+     *
+     *  @param[in] io - io context the completions are run on
+     *  @param[in] metrics - metrics recording the time taken by the writes
+     */
+    FileWriter(boost::asio::io_context& io, Metrics& metrics);
+
+    /** @brief Writes out the requests still queued and stops the thread.
+     *         Completions that have not run yet are dropped.
+     */
+    ~FileWriter();
+
+    /** @brief Atomically replace the content of a file.
+     *
+     *  @param[in] path - path to the file
+     *  @param[in] data - new content of the file
+     *  @param[in] done - run on the io context once the file is replaced,
+     *                    with false if it could not be written
+     */
+    void replace(const std::filesystem::path& path, std::string data,
+                 Done done = {});
+
+    /** @brief Append data to an existing file.
+     *
+     *  @param[in] path - path to the file
+     *  @param[in] data - data to append
+     *  @param[in] done - run on the io context once the data is appended,
+     *                    with false if the file does not exist, the data
+     *                    could not be written or an earlier write to the
+     *                    file failed
+     */
+    void append(const std::filesystem::path& path, std::string data,
+                Done done = {});
+
+    /** @brief Block until every request submitted so far is written, then
+     *         run their completions.
+     */
+    void drain();
+
+    /** @brief Synchronously and atomically replace the content of a file.
+     *
+     *  @return true if the file was replaced.
+     */
+    static bool replaceFile(const std::filesystem::path& path,
+                            const std::string& data);
+
+    /** @brief Synchronously append data to an existing file.
+     *
+     *  @return true if the data was appended.
+     */
+    static bool appendFile(const std::filesystem::path& path,
+                           const std::string& data);
+
+    /** @brief Synchronously rename a file that could not be loaded to
+     *         <path>.corrupt, replacing an earlier one, so that the state is
+     *         started afresh without losing what the file holds.
+     *
+     *  @return true if the file was renamed.
+     */
+    static bool setAside(const std::filesystem::path& path);
+
+  private:
+    enum class Mode
+    {
+        replace,
+        append,
+    };
+
+    struct Request
+    {
+        std::filesystem::path path;
+        Mode mode;
+        std::string data;
+        std::vector<Done> done;
+        bool ok = false;
+    };
+
+    void submit(Request request, Done done);
+
+    /** @brief Writer thread: swap the buffers and write out the requests. */
+    void run();
+
+    /** @brief Write out one request, on the writer thread.
+     *
+     *  @return true if it was written.
+     */
+    bool write(const Request& request);
+
+    /** @brief Wait for the writer thread to signal completed requests. */
+    void waitCompletions();
+
+    /** @brief Run the completions of the requests written so far. */
+    void runCompletions();
+
+    Metrics& metrics;
+
+    std::mutex mutex;
+    std::condition_variable wakeWriter;
+    std::condition_variable idle;
+
+    /** @brief Requests filled by the io context, guarded by mutex */
+    std::vector<Request> queued;
+    /** @brief Requests written by the thread, guarded by mutex */
+    std::vector<Request> completed;
+    bool writing = false;
+    bool stopping = false;
+
+    /** @brief Files a write failed on since they were last replaced, only
+     *         used by the thread
+     */
+    std::set<std::filesystem::path> failed;
+
+    /** @brief eventfd the thread signals completed requests on */
+    boost::asio::posix::stream_descriptor event;
+    int eventFd;
+    uint64_t eventCount = 0;
+
+    std::thread thread;
+};
+
+} // namespace bios_config
@@ -16,19 +16,59 @@
 
 #pragma once
 
+#include "attribute_dependencies.hpp"
+#include "attribute_snapshot.hpp"
+#include "attribute_store.hpp"
+#include "bios_image.hpp"
+#include "metrics.hpp"
+#include "persist_scheduler.hpp"
+#include "worker_pool.hpp"
+
+#include <boost/asio/spawn.hpp>
 #include <sdbusplus/asio/object_server.hpp>
 #include <sdbusplus/server.hpp>
 #include <xyz/openbmc_project/BIOSConfig/Manager/server.hpp>
 
+#include <chrono>
 #include <filesystem>
+#include <memory>
+#include <optional>
+#include <set>
 #include <string>
+#include <string_view>
 
 namespace bios_config
 {
 
 static constexpr auto service = "xyz.openbmc_project.BIOSConfigManager";
 static constexpr auto objectPath = "/xyz/openbmc_project/bios_config/manager";
+static constexpr auto managerExtInterface =
+    "xyz.openbmc_project.BIOSConfig.ManagerExt";
 constexpr auto biosPersistFile = "biosData";
+constexpr auto biosDependenciesFile = "biosDependencies.json";
+
+/** @brief Largest number of attributes accepted in one chunk of a staged
+ *         BaseBIOSTable upload.
+ */
+constexpr size_t maxTableChunkSize = 1024;
+
+/** @brief Largest number of attributes a staged upload may hold. */
+constexpr size_t maxStagedAttributes = 65536;
+
+/** @brief Time after which an upload without any call from its owner may be
+ *         taken over by another BeginTableUpload.
+ */
+constexpr auto tableUploadTimeout = std::chrono::seconds(30);
+
+/** @brief Largest number of attributes returned in one page of the
+ *         BaseBIOSTable or PendingAttributes.
+ */
+constexpr size_t maxPageSize = 1024;
+
+/** @brief Largest number of attribute reads waiting for a reader thread,
+ *         further reads are answered on the io context.
+ */
+constexpr size_t maxQueuedReads = 64;
 
 using Base = sdbusplus::xyz::openbmc_project::BIOSConfig::server::Manager;
 namespace fs = std::filesystem;
@@ -64,6 +104,18 @@ class Manager : public Base
     using PendingValue = std::variant<int64_t, std::string>;
     using AttributeDetails =
         std::tuple<AttributeType, CurrentValue, PendingValue>;
+    using AttributeValues = std::map<AttributeName, AttributeValue>;
+    using TableDiffReport =
+        std::tuple<std::vector<AttributeName>, std::vector<AttributeName>,
+                   std::vector<AttributeName>>;
+    using AttributeState = std::tuple<bool, bool, int64_t, int64_t>;
+    using AttributeDetailsReport =
+        std::tuple<std::map<AttributeName, AttributeDetails>,
+                   std::vector<AttributeName>>;
+    using MenuReport = std::tuple<std::vector<std::string>,
+                                  std::map<AttributeName, AttributeDetails>>;
+    using TablePage = std::tuple<BaseTable, std::string>;
+    using PendingPage = std::tuple<PendingAttributes, std::string>;
     using Base::resetBIOSSettings;
 
     Manager() = delete;
@@ -77,10 +129,14 @@ class Manager : public Base
      *
      *  @param[in] objectServer  - object server
      *  @param[in] systemBus - bus connection
+     *  @param[in] persistPath - path to the bios data file
+     *  @param[in] scheduler - scheduler of the writes to the bios data file
+     *  @param[in] metrics - metrics recording the handler latencies
      */
     Manager(sdbusplus::asio::object_server& objectServer,
             std::shared_ptr<sdbusplus::asio::connection>& systemBus,
-            std::string persistPath);
+            std::string persistPath, PersistScheduler& scheduler,
+            Metrics& metrics);
 
     /** @brief Set the BIOS attribute with a new value, the new value is added
      *         to the PendingAttribute.
@@ -92,7 +148,19 @@ class Manager : public Base
      */
     void setAttribute(AttributeName attribute, AttributeValue value) override;
 
-    /** @brief Get the details of the BIOS attribute
+    /** @brief Set several BIOS attributes at once. The new values are
+     *         validated against the BaseBIOSTable before any of them is
+     *         added to the PendingAttributes, so either all of them are
+     *         applied or none. The change is persisted and signalled once.
+     *
+     *  @param[in] values - map of attribute names to new values
+     *
+     *  @return On error, throw exception
+     */
+    void setAttributes(AttributeValues values);
+
+    /** @brief Get the details of the BIOS attribute. An attribute hidden
+     *         by a dependency is not found.
      *
      *  @param[in] attribute - attribute name
      *
@@ -101,8 +169,81 @@ class Manager : public Base
      */
     AttributeDetails getAttribute(AttributeName attribute) override;
 
-    /** @brief Set the BaseBIOSTable property and clears the PendingAttributes
-     *         property
+    /** @brief Get the details of several BIOS attributes at once, from one
+     *         snapshot of the attributes.
+     *
+     *  @param[in] names - attribute names, all the attributes if empty
+     *
+     *  @return The attribute details of the attributes found, by name, and
+     *          the names that are not in the BaseBIOSTable or are hidden by
+     *          a dependency.
+     */
+    AttributeDetailsReport getAttributes(std::vector<AttributeName> names);
+
+    /** @brief getAttributes, run on a reader thread while the io context
+     *         serves the other requests.
+     *
+     *  @param[in] yield - coroutine of the D-Bus method call
+     *  @param[in] names - attribute names, all the attributes if empty
+     */
+    AttributeDetailsReport getAttributes(boost::asio::yield_context yield,
+                                         std::vector<AttributeName> names);
+
+    /** @brief List a submenu of the BIOS setup menu, as given by the menu
+     *         paths of the attributes.
+     *
+     *  @param[in] path - menu path of the submenu, e.g. "./SysMgmt", the
+     *                    top of the menu if empty
+     *
+     *  @return Names of the child submenus, and the details of the
+     *          attributes directly in the submenu that are not hidden, by
+     *          name. On error, throw exception
+     */
+    MenuReport getMenu(std::string path);
+
+    /** @brief getMenu, run on a reader thread.
+     */
+    MenuReport getMenu(boost::asio::yield_context yield, std::string path);
+
+    /** @brief Get a page of the BaseBIOSTable. Pages follow each other in
+     *         attribute name order; a client streams the whole table by
+     *         passing the cursor returned with each page to the next call.
+     *         The cursor is bound to the BaseBIOSTable it was returned for,
+     *         once the table is replaced it is rejected and the client has
+     *         to start over.
+     *
+     *  @param[in] cursor - cursor returned with the previous page, empty for
+     *                      the first page
+     *  @param[in] pageSize - largest number of attributes in the page, at
+     *                        most maxPageSize
+     *
+     *  @return The attributes of the page that are not hidden, by name,
+     *          and the cursor of the next page, empty after the last page.
+     *          On error, throw exception
+     */
+    TablePage getBaseTablePage(std::string cursor, uint32_t pageSize);
+
+    /** @brief getBaseTablePage, run on a reader thread.
+     */
+    TablePage getBaseTablePage(boost::asio::yield_context yield,
+                               std::string cursor, uint32_t pageSize);
+
+    /** @brief Get a page of the PendingAttributes, as getBaseTablePage
+     *         does for the BaseBIOSTable. The cursor is rejected once the
+     *         pending values have changed.
+     */
+    PendingPage getPendingPage(std::string cursor, uint32_t pageSize);
+
+    /** @brief getPendingPage, run on a reader thread.
+     */
+    PendingPage getPendingPage(boost::asio::yield_context yield,
+                               std::string cursor, uint32_t pageSize);
+
+    /** @brief Set the BaseBIOSTable property. The new table is compared with
+     *         the current one by attribute name; pending values are kept for
+     *         the attributes whose definition did not change, unless the new
+     *         current value shows they were applied. Only the attributes that
+     *         differ are persisted, and an identical table changes nothing.
      *
      *  @param[in] value - new BaseBIOSTable
      *
@@ -112,6 +253,97 @@ class Manager : public Base
 
     ResetFlag resetBIOSSettings(ResetFlag value);
 
+    /** @brief Get the BaseBIOSTable property, decoded from the mapped image
+     *         while the attributes are not materialized, else built from the
+     *         attribute store.
+     */
+    BaseTable baseBIOSTable() const override;
+
+    /** @brief Get the PendingAttributes property, decoded from the mapped
+     *         image while the attributes are not materialized, else taken
+     *         from the latest snapshot.
+     */
+    PendingAttributes pendingAttributes() const override;
+
+    /** @brief Serve the attributes from a mapped image of the persisted file
+     *         until a change needs them in memory.
+     *
+     *  @param[in] mapped - image of the persisted file
+     */
+    void useImage(std::unique_ptr<BiosImage> mapped);
+
+    /** @brief Report of the last BaseBIOSTable update, for debugging.
+     *
+     *  @return Names of the attributes added, removed and changed.
+     */
+    TableDiffReport getTableDiff() const;
+
+    /** @brief Replace the attribute dependency rules and persist them. The
+     *         rules constrain the changes made from now on; values that are
+     *         already pending are kept.
+     *
+     *  @param[in] rules - JSON description of the rules, see
+     *                     AttributeDependencies::parse
+     *
+     *  @return On error, throw exception
+     */
+    void setDependencies(std::string rules);
+
+    /** @brief State of an attribute with its dependency rules applied,
+     *         from the latest snapshot. Hidden attributes are reported too.
+     *
+     *  @param[in] attribute - attribute name
+     *
+     *  @return Whether the attribute is read-only, whether it is hidden, and
+     *          its lower and upper bound, 0 for attributes that are not
+     *          integers. On error, throw exception
+     */
+    AttributeState getAttributeState(AttributeName attribute);
+
+    /** @brief Start a staged upload of a BaseBIOSTable. Only one upload is
+     *         in progress at a time: an upload that is still in progress is
+     *         abandoned only once it has been idle for tableUploadTimeout.
+     *
+     *  @param[in] owner - unique bus name of the caller, the only one that
+     *                     may continue the upload
+     *
+     *  @return Identifier of the upload transaction. Throw Unavailable if
+     *          another upload is in progress
+     */
+    uint64_t beginTableUpload(const std::string& owner);
+
+    /** @brief Add a chunk of attributes to a staged upload. Attributes that
+     *         were already staged are replaced.
+     *
+     *  @param[in] owner - unique bus name of the caller
+     *  @param[in] id - identifier of the upload transaction
+     *  @param[in] chunk - at most maxTableChunkSize attributes, the upload
+     *                     may hold at most maxStagedAttributes
+     *
+     *  @return On error, throw exception
+     */
+    void appendTableChunk(const std::string& owner, uint64_t id,
+                          BaseTable chunk);
+
+    /** @brief Apply the staged table as the new BaseBIOSTable, exactly as if
+     *         it had been set in one piece.
+     *
+     *  @param[in] owner - unique bus name of the caller
+     *  @param[in] id - identifier of the upload transaction
+     *
+     *  @return On error, throw exception
+     */
+    void commitTableUpload(const std::string& owner, uint64_t id);
+
+    /** @brief Drop a staged upload without applying it.
+     *
+     *  @param[in] owner - unique bus name of the caller
+     *  @param[in] id - identifier of the upload transaction
+     *
+     *  @return On error, throw exception
+     */
+    void abortTableUpload(const std::string& owner, uint64_t id);
+
     /** @brief Set the PendingAttributes property, additionally checks if the
      *         attributes are in the BaseBIOSTable, whether the attributes are
      *         read only and validate the attribute value based on the
@@ -140,27 +372,236 @@ class Manager : public Base
         options,
     };
 
-    bool validateEnumOption(
-        const std::string& attrValue,
-        const std::vector<std::tuple<
-            BoundType, std::variant<int64_t, std::string>, std::string>>&
-            options);
+    bool validateEnumOption(const std::string& attrValue,
+                            const AttributeStore::Entry& entry);
+
+    bool validateStringOption(const std::string& attrValue,
+                              const AttributeStore::Constraint& constraint);
+
+    bool validateIntegerOption(const int64_t& attrValue,
+                               const AttributeStore::Constraint& constraint);
+
+    /** @brief Validate a pending attribute against the BaseBIOSTable and
+     *         count the failures.
+     *
+     *  @param[in] name - attribute name
+     *  @param[in] value - attribute type and new value
+     *
+     *  @return On error, throw exception
+     */
+    void validatePendingAttribute(const std::string& name,
+                                  const PendingAttribute& value);
+
+    /** @brief Check a pending attribute against the BaseBIOSTable.
+     *
+     *  @param[in] name - attribute name
+     *  @param[in] value - attribute type and new value
+     *
+     *  @return On error, throw exception
+     */
+    void checkPendingAttribute(const std::string& name,
+                               const PendingAttribute& value);
+
+    /** @brief Effective value of an attribute for the dependency rules.
+     *
+     *  @param[in] name - attribute name
+     *  @param[in] delta - pending attributes about to be set
+     *
+     *  @return The value in delta, else the pending value, else the current
+     *          value; nullptr if the attribute is not in the BaseBIOSTable.
+     */
+    const AttributeStore::Value*
+        effectiveValue(std::string_view name,
+                       const PendingAttributes& delta) const;
+
+    /** @brief Check validated pending attributes against the dependency
+     *         rules and apply the states they lead to. Only the attributes
+     *         depending on the changed ones are evaluated.
+     *
+     *  @param[in] delta - validated pending attributes about to be set
+     *
+     *  @return On error, throw exception
+     */
+    void checkDependencies(const PendingAttributes& delta);
+
+    /** @brief Evaluate the dependency rules for the whole table, after the
+     *         table or all the pending values changed, reading a mapped image
+     *         in place, and publish the states.
+     */
+    void evaluateDependencies();
+
+    /** @brief Load the dependency rules persisted by setDependencies.
+     */
+    void loadDependencies();
+
+    /** @brief Validate and add attributes to the PendingAttributes property,
+     *         or clear it if value is empty. Shared by the PendingAttributes
+     *         setter and SetAttribute.
+     *
+     *  @param[in] value - new PendingAttributes to append
+     *
+     *  @return On error, throw exception
+     */
+    void updatePending(PendingAttributes value);
+
+    /** @brief Pending value of an attribute.
+     *
+     *  @param[in] name - attribute name
+     *
+     *  @return nullptr if the attribute has no pending value.
+     */
+    const PendingAttribute* findPending(const std::string& name) const;
+
+    /** @brief Number of attributes with a pending value.
+     */
+    size_t pendingCount() const;
+
+    /** @brief Drop the loaded pending values of attributes that are not in
+     *         the BaseBIOSTable.
+     *
+     *  @param[in] loaded - pending values read from the persisted file
+     *
+     *  @return The pending values to publish.
+     */
+    std::shared_ptr<PendingAttributes>
+        knownPending(PendingAttributes loaded) const;
+
+    /** @brief Emit PropertiesChanged for the PendingAttributes property,
+     *         once the new values are published.
+     */
+    void signalPending();
+
+    /** @brief Emit PropertiesChanged for the BaseBIOSTable property, once
+     *         the new table is in the store.
+     */
+    void signalBaseTable();
+
+    /** @brief Publish the sizes of the BaseBIOSTable and PendingAttributes.
+     */
+    void updateSizeMetrics();
+
+    /** @brief Publish a snapshot of the current table and pending values
+     *         to the readers.
+     *
+     *  @param[in] pending - PendingAttributes property value
+     *  @param[in] newTable - whether the BaseBIOSTable was replaced since
+     *                        the previous snapshot
+     */
+    void publish(std::shared_ptr<PendingAttributes> pending,
+                 bool newTable = false);
+
+    /** @brief Run a read of the latest snapshot on a reader thread and
+     *         resume the calling coroutine with its result, or run it here
+     *         if too many reads are waiting already.
+     *
+     *  @param[in] yield - coroutine of the D-Bus method call
+     *  @param[in] read - called with the snapshot, may throw
+     *
+     *  @return The result of read.
+     */
+    template <typename Read>
+    auto onReader(boost::asio::yield_context yield, Read read);
 
-    bool validateStringOption(
-        const std::string& attrValue,
-        const std::vector<std::tuple<
-            BoundType, std::variant<int64_t, std::string>, std::string>>&
-            options);
+    /** @brief Add validated attributes to the PendingAttributes property and
+     *         persist the change.
+     *
+     *  @param[in] delta - validated pending attributes
+     */
+    void applyPending(const PendingAttributes& delta);
+
+    /** @brief Queue a change of the pending attributes for the next journal
+     *         record.
+     *
+     *  @param[in] value - pending attributes that were set, empty if the
+     *                     pending attributes were cleared
+     */
+    void persistPending(const PendingAttributes& value);
 
-    bool validateIntegerOption(
-        const int64_t& attrValue,
-        const std::vector<std::tuple<
-            BoundType, std::variant<int64_t, std::string>, std::string>>&
-            options);
+    /** @brief Encode the queued changes and hand them to the writer
+     *         thread, called by the persist scheduler. Changes are appended
+     *         to the journal, unless a snapshot is due because the table
+     *         changed, the journal grew too large or a record failed.
+     */
+    void persist();
+
+    /** @brief Decode the mapped image into the D-Bus properties and the
+     *         attribute store and drop it. Called before any change.
+     */
+    void materialize();
 
     sdbusplus::asio::object_server& objServer;
     std::shared_ptr<sdbusplus::asio::connection>& systemBus;
     std::filesystem::path biosFile;
+    std::filesystem::path dependenciesFile;
+
+    PersistScheduler& scheduler;
+    PersistScheduler::WriterId writerId;
+    Metrics& metrics;
+
+    /** @brief Threads the long reads of the attributes run on */
+    WorkerPool readers;
+
+    /** @brief Staged BaseBIOSTable upload that is in progress */
+    struct TableUpload
+    {
+        uint64_t id;
+        std::string owner;
+        std::chrono::steady_clock::time_point lastActivity;
+        BaseTable table;
+    };
+    std::optional<TableUpload> tableUpload;
+    uint64_t lastUploadId = 0;
+
+    /** @brief Return the staged upload with the given identifier, throw if
+     *         there is none or it belongs to another caller.
+     */
+    TableUpload& stagedUpload(const std::string& owner, uint64_t id);
+
+    /** @brief Methods that are not part of the Manager interface */
+    std::shared_ptr<sdbusplus::asio::dbus_interface> extIface;
+
+    /** @brief Bytes of journal appended since the last snapshot */
+    size_t journalSize = 0;
+
+    /** @brief Changes waiting for the next commit */
+    bool snapshotDirty = false;
+    bool journalClear = false;
+    PendingAttributes journalDelta;
+    BaseTable journalTableUpserts;
+    std::set<std::string> journalTableRemovals;
+
+    /** @brief Differences found by the last BaseBIOSTable update */
+    AttributeStore::TableDiff lastTableDiff;
+
+    /** @brief Indexed store that backs the BaseBIOSTable property. A new
+     *         store is built for every new table, since the published
+     *         snapshots share it.
+     */
+    std::shared_ptr<AttributeStore> attributes =
+        std::make_shared<AttributeStore>();
+
+    /** @brief Whether the pending value of an attribute was validated
+     *         against the current table, indexed like attributes->all().
+     */
+    std::vector<bool> validatedPending;
+
+    /** @brief Persisted file mapped at startup, set until the attributes are
+     *         materialized.
+     */
+    std::shared_ptr<const BiosImage> image;
+
+    /** @brief BaseBIOSTable decoded from the image by the first read of the
+     *         property, dropped with the image.
+     */
+    mutable std::optional<BaseTable> imageTable;
+
+    /** @brief Snapshots that attribute reads go through, the latest one
+     *         holds the PendingAttributes
+     */
+    SnapshotPublisher snapshots;
+
+    /** @brief Rules making attributes depend on each other */
+    AttributeDependencies dependencies;
 };
 
 } // namespace bios_config
@@ -3,19 +3,80 @@
 #include "manager.hpp"
 
 #include <filesystem>
+#include <set>
+#include <string>
 
 namespace bios_config
 {
 
-/** @brief Serialize and persist the bios manager object
+/** @brief Once the journal appended to the persisted file grows beyond this
+ *         many bytes it is compacted into a new snapshot.
+ */
+constexpr size_t journalCompactSize = 64 * 1024;
+
+/** @enum Type of the records appended to the persisted file after the
+ *        snapshot of the bios manager object.
+ */
+enum class JournalOp : uint8_t
+{
+    setPending = 0,
+    clearPending,
+    updateTable,
+};
+
+/** @brief Serialize and persist a snapshot of the bios manager object in the
+ *         indexed image format of BiosImage, compressed if configured. The
+ *         snapshot replaces the file atomically, dropping any journal. The
+ *         file is written and synced on the calling thread.
  *
  *  @param[in] obj - bios manager object
  *  @param[in] path - path to the file where the bios manager object
  *                    is to be serialized
+ *
+ *  @return Number of bytes written, 0 if the snapshot could not be written.
+ */
+size_t serialize(const Manager& obj, const fs::path& path);
+
+/** @brief Encode a snapshot of the bios manager object in the indexed image
+ *         format of BiosImage, compressed if configured, to be written by
+ *         the FileWriter.
+ *
+ *  @param[in] obj - bios manager object
+ *
+ *  @return The encoded snapshot
+ */
+std::string encodeSnapshot(const Manager& obj);
+
+/** @brief Encode a change of the pending attributes as a record of the
+ *         journal that follows the snapshot in the persisted file.
+ *
+ *  @param[in] op - type of the change
+ *  @param[in] delta - pending attributes that were set, empty when the
+ *                     pending attributes were cleared
+ *
+ *  @return The encoded record
+ */
+std::string encodeJournal(JournalOp op,
+                          const Manager::PendingAttributes& delta);
+
+/** @brief Encode a change of the BaseBIOSTable as a record of the journal
+ *         that follows the snapshot in the persisted file.
+ *
+ *  @param[in] upserts - attributes that were added or changed
+ *  @param[in] removals - names of the attributes that were removed
+ *
+ *  @return The encoded record
  */
-void serialize(const Manager& obj, const fs::path& path);
+std::string encodeJournal(const Manager::BaseTable& upserts,
+                          const std::set<std::string>& removals);
 
-/** @brief Deserialize the persisted data and populate the bios manager object
+/** @brief Deserialize the persisted data and populate the bios manager object.
+ *         A snapshot that is not followed by journal records is mapped and
+ *         handed to the object as it is, to be decoded only when a change
+ *         needs it. Otherwise the journal records are replayed, after which
+ *         the file is compacted into a fresh snapshot; files written in the
+ *         former cereal format are converted the same way. A file that
+ *         cannot be loaded is renamed to <path>.corrupt and kept.
  *
  *  @param[in] path - path to the persisted file
  *  @param[in/out] entry - reference to the bios manager object which is the
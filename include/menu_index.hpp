@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace bios_config
+{
+
+/** @class MenuIndex
+ *
+ *  @brief Prefix tree over the menu paths of the BIOS attributes.
+ *
+ *  Menu paths like "./SysMgmt/ProcessorSettings" are split on '/' into
+ *  submenus, "." and empty components are skipped. Each node of the tree
+ *  holds its child submenus and the attributes placed directly in it, so
+ *  a submenu is found by walking its path and listed without touching the
+ *  rest of the table.
+ */
+class MenuIndex
+{
+  public:
+    /** @struct Node
+     *
+     *  @brief A submenu: its child submenus by name, and the indices of the
+     *         attributes directly in it, in the order they were added.
+     */
+    struct Node
+    {
+        std::map<std::string, uint32_t, std::less<>> children;
+        std::vector<uint32_t> attributes;
+    };
+
+    MenuIndex() : nodes(1) {}
+
+    /** @brief Drop every submenu and attribute.
+     */
+    void clear();
+
+    /** @brief Add an attribute to the submenu at its menu path, creating the
+     *         submenus on the way.
+     *
+     *  @param[in] menuPath - menu path of the attribute
+     *  @param[in] attribute - index of the attribute
+     */
+    void add(std::string_view menuPath, uint32_t attribute);
+
+    /** @brief Find a submenu.
+     *
+     *  @param[in] path - menu path, the root if it has no component
+     *
+     *  @return The submenu, nullptr if there is no such submenu
+     */
+    const Node* find(std::string_view path) const;
+
+    /** @brief Submenu by index, as found in Node::children.
+     */
+    const Node& node(uint32_t index) const
+    {
+        return nodes[index];
+    }
+
+    /** @brief Number of submenus, including the root.
+     */
+    size_t size() const
+    {
+        return nodes.size();
+    }
+
+  private:
+    /** @brief Node 0 is the root */
+    std::vector<Node> nodes;
+};
+
+} // namespace bios_config
@@ -0,0 +1,232 @@
+#pragma once
+
+#include <sdbusplus/asio/object_server.hpp>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <string>
+#include <string_view>
+
+namespace bios_config
+{
+
+static constexpr auto metricsObjectPath =
+    "/xyz/openbmc_project/bios_config/metrics";
+static constexpr auto metricsInterface =
+    "xyz.openbmc_project.BIOSConfig.Metrics";
+
+/** @class Histogram
+ *
+ *  @brief Latency histogram with fixed buckets.
+ *
+ *  Bucket i counts the durations of at most 2^i microseconds that did not
+ *  fit in bucket i - 1, the last bucket counts everything longer. Finding
+ *  the bucket is a single bit scan and recording takes three relaxed atomic
+ *  increments, so it is cheap enough to stay enabled.
+ */
+class Histogram
+{
+  public:
+    static constexpr size_t bucketCount = 24;
+
+    /** @brief Record a duration.
+     *
+     *  @param[in] duration - measured duration
+     */
+    void record(std::chrono::nanoseconds duration)
+    {
+        auto nanoseconds = static_cast<uint64_t>(
+            std::max<std::chrono::nanoseconds::rep>(duration.count(), 0));
+        uint64_t microseconds = (nanoseconds + 999) / 1000;
+        size_t bucket =
+            microseconds == 0 ? 0 : std::bit_width(microseconds - 1);
+
+        buckets[std::min(bucket, bucketCount - 1)].fetch_add(
+            1, std::memory_order_relaxed);
+        count.fetch_add(1, std::memory_order_relaxed);
+        sum.fetch_add(nanoseconds, std::memory_order_relaxed);
+    }
+
+    /** @brief Append the histogram in the Prometheus text format.
+     *
+     *  @param[in,out] out - text to append to
+     *  @param[in] name - metric name
+     *  @param[in] labels - labels of the metric, without braces
+     */
+    void write(std::string& out, std::string_view name,
+               std::string_view labels) const;
+
+  private:
+    std::array<std::atomic<uint64_t>, bucketCount> buckets{};
+    std::atomic<uint64_t> count{0};
+
+    /** @brief Sum of the recorded durations in nanoseconds */
+    std::atomic<uint64_t> sum{0};
+};
+
+/** @class Metrics
+ *
+ *  @brief Runtime metrics of the daemon: a latency histogram and an error
+ *         counter for every D-Bus handler, the latency and volume of the
+ *         writes to persistent storage, validation failures and the size of
+ *         the BIOS tables.
+ *
+ *  The counters are published as D-Bus properties, everything is available
+ *  in the Prometheus text format through the Dump method.
+ */
+class Metrics
+{
+  public:
+    /** @enum D-Bus handlers whose latency is recorded */
+    enum class Handler : uint8_t
+    {
+        getAttribute = 0,
+        getAttributes,
+        getMenu,
+        getBaseTablePage,
+        getPendingPage,
+        setAttribute,
+        setAttributes,
+        pendingAttributes,
+        baseBIOSTable,
+        changePassword,
+        currentBoot,
+        pendingEnable,
+        mode,
+    };
+    static constexpr size_t handlerCount = 13;
+
+    /** @class Timer
+     *
+     *  @brief Records the time from its construction to its destruction in
+     *         the histogram of a handler, and counts an error if it is
+     *         destroyed by an exception.
+     */
+    class Timer
+    {
+      public:
+        Timer(Metrics& metrics, Handler handler) :
+            metrics(metrics), handler(handler),
+            exceptions(std::uncaught_exceptions()),
+            start(std::chrono::steady_clock::now())
+        {}
+
+        ~Timer()
+        {
+            auto index = static_cast<uint8_t>(handler);
+            metrics.latencies[index].record(
+                std::chrono::steady_clock::now() - start);
+            if (std::uncaught_exceptions() > exceptions)
+            {
+                metrics.errors[index].fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+
+        Timer(const Timer&) = delete;
+        Timer& operator=(const Timer&) = delete;
+        Timer(Timer&&) = delete;
+        Timer& operator=(Timer&&) = delete;
+
+      private:
+        Metrics& metrics;
+        Handler handler;
+        int exceptions;
+        std::chrono::steady_clock::time_point start;
+    };
+
+    Metrics() = delete;
+    ~Metrics() = default;
+    Metrics(const Metrics&) = delete;
+    Metrics& operator=(const Metrics&) = delete;
+    Metrics(Metrics&&) = delete;
+    Metrics& operator=(Metrics&&) = delete;
+
+    /** @brief Constructs Metrics object.
+     *
+     *  @param[in] objectServer - object server
+     */
+    explicit Metrics(sdbusplus::asio::object_server& objectServer);
+
+    /** @brief Time a handler until the returned timer goes out of scope.
+     *
+     *  @param[in] handler - handler being run
+     */
+    Timer time(Handler handler)
+    {
+        return {*this, handler};
+    }
+
+    /** @brief Record the time taken to encode the state to persist and
+     *         hand it to the writer thread.
+     */
+    void recordPersist(std::chrono::nanoseconds duration)
+    {
+        persistLatency.record(duration);
+    }
+
+    /** @brief Record the time the writer thread took to write a file to
+     *         persistent storage and sync it.
+     */
+    void recordWrite(std::chrono::nanoseconds duration)
+    {
+        writeLatency.record(duration);
+    }
+
+    /** @brief Count bytes written to persistent storage.
+     */
+    void addPersistedBytes(uint64_t bytes)
+    {
+        persistedBytes.fetch_add(bytes, std::memory_order_relaxed);
+    }
+
+    /** @brief Count a value rejected by the validation against the
+     *         BaseBIOSTable.
+     */
+    void countValidationFailure()
+    {
+        validationFailures.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    /** @brief Count a password change admitted to, or refused before, the
+     *         key derivation.
+     */
+    void countPasswordAdmission(bool admitted)
+    {
+        (admitted ? passwordAdmitted : passwordRejected)
+            .fetch_add(1, std::memory_order_relaxed);
+    }
+
+    /** @brief Set the number of attributes in the BaseBIOSTable and in the
+     *         PendingAttributes.
+     */
+    void setTableSizes(size_t table, size_t pending)
+    {
+        tableSize.store(table, std::memory_order_relaxed);
+        pendingSize.store(pending, std::memory_order_relaxed);
+    }
+
+    /** @brief All the metrics in the Prometheus text exposition format.
+     */
+    std::string dump() const;
+
+  private:
+    std::array<Histogram, handlerCount> latencies;
+    std::array<std::atomic<uint64_t>, handlerCount> errors{};
+    Histogram persistLatency;
+    Histogram writeLatency;
+    std::atomic<uint64_t> persistedBytes{0};
+    std::atomic<uint64_t> validationFailures{0};
+    std::atomic<uint64_t> passwordAdmitted{0};
+    std::atomic<uint64_t> passwordRejected{0};
+    std::atomic<uint64_t> tableSize{0};
+    std::atomic<uint64_t> pendingSize{0};
+    std::shared_ptr<sdbusplus::asio::dbus_interface> iface;
+};
+
+} // namespace bios_config
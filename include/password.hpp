@@ -18,33 +18,62 @@
 #include <openssl/evp.h>
 #include <openssl/hmac.h>
 #include <openssl/sha.h>
+#include <sys/types.h>
 
-#include <nlohmann/json.hpp>
+#include "metrics.hpp"
+#include "password_admission.hpp"
+#include "password_kdf.hpp"
+#include "password_store.hpp"
+#include "persist_scheduler.hpp"
+#include "worker_pool.hpp"
+
+#include <boost/asio/spawn.hpp>
 #include <sdbusplus/asio/object_server.hpp>
 #include <sdbusplus/server.hpp>
-#include <xyz/openbmc_project/BIOSConfig/Password/server.hpp>
 
+#include <array>
 #include <filesystem>
+#include <memory>
+#include <optional>
 #include <string>
 
 namespace bios_config_pwd
 {
 static constexpr auto objectPathPwd =
     "/xyz/openbmc_project/bios_config/password";
+static constexpr auto passwordInterface =
+    "xyz.openbmc_project.BIOSConfig.Password";
 constexpr auto biosSeedFile = "seedData";
-constexpr uint8_t maxHashSize = 64;
-constexpr uint8_t maxSeedSize = 32;
+constexpr auto biosPasswordStoreFile = "passwordStore";
 constexpr uint8_t maxPasswordLen = 32;
-constexpr int iterValue = 1000;
 
-using Base = sdbusplus::xyz::openbmc_project::BIOSConfig::server::Password;
+/** @brief Largest number of password changes waiting for a key derivation
+ *         worker; further changes are refused until one completes.
+ */
+constexpr size_t maxQueuedPasswordChanges = 8;
+
+/** @brief Password changes a caller may burst, then one every 2 seconds */
+constexpr AdmissionControl::Limits callerPasswordLimits{
+    5, std::chrono::seconds(2)};
+
+/** @brief Password changes for the admin or the user password, whatever
+ *         the caller
+ */
+constexpr AdmissionControl::Limits targetPasswordLimits{
+    10, std::chrono::seconds(1)};
+
 namespace fs = std::filesystem;
 
 /** @class Password
  *
  *  @brief Implements the BIOS Password
+ *
+ *  The interface is served through the asio object server so that
+ *  ChangePassword can reply asynchronously: the key derivations run on a
+ *  worker pool while the io context keeps serving the other requests, and
+ *  the method replies once they are done.
  */
-class Password : public Base
+class Password
 {
   public:
     Password() = delete;
@@ -58,40 +87,168 @@ class Password : public Base
      *
      *  @param[in] objectServer  - object server
      *  @param[in] systemBus - bus connection
+     *  @param[in] persistPath - directory of the seed data file and of the
+     *                           password store caching it
+     *  @param[in] scheduler - scheduler of the writes of the seed data
+     *  @param[in] metrics - metrics recording the time taken by
+     *                       ChangePassword
      */
     Password(sdbusplus::asio::object_server& objectServer,
              std::shared_ptr<sdbusplus::asio::connection>& systemBus,
-             std::string persistPath);
+             std::string persistPath, bios_config::PersistScheduler& scheduler,
+             bios_config::Metrics& metrics);
 
-    /** @brief Set the BIOS attribute with a new value, the new value is added
-     *         to the PendingAttribute.
+    /** @brief Change the BIOS password. The current password is verified
+     *         and the new one hashed on the worker pool, the coroutine is
+     *         suspended meanwhile. Callers that change passwords too often
+     *         or got the current password wrong repeatedly are refused
+     *         before any key derivation.
      *
+     *  @param[in] yield - coroutine of the D-Bus method call
+     *  @param[in] caller - unique bus name of the caller
      *  @param[in] userName - User name - user / admin.
      *  @param[in] currentPassword - Current user/ admin Password.
      *  @param[in] newPassword - New user/ admin Password.
      */
-    void changePassword(std::string userName, std::string currentPassword,
-                        std::string newPassword) override;
+    void changePassword(boost::asio::yield_context yield,
+                        const std::string& caller, std::string userName,
+                        std::string currentPassword, std::string newPassword);
+
+    /** @brief Verify the current password against the stored hash and hash
+     *         the new password. Runs on a worker, it only reads its
+     *         arguments.
+     *
+     *  @param[in] params - stored seed data
+     *  @param[in] userName - User name - user / admin.
+     *  @param[in] currentPassword - Current user/ admin Password.
+     *  @param[in] newPassword - New user/ admin Password.
+     *  @param[in] newKdf - key derivation of the new hash
+     *
+     *  @return The hash of the new password. On error, throw exception
+     */
+    static Hash verifyPassword(const SeedParams& params,
+                               const std::string& userName,
+                               const std::string& currentPassword,
+                               const std::string& newPassword,
+                               const KdfParams& newKdf);
 
   private:
-    void verifyPassword(std::string userName, std::string currentPassword,
-                        std::string newPassword);
-    bool compareDigest(const EVP_MD* digestFunc, size_t digestLen,
-                       const std::array<uint8_t, maxHashSize>& expected,
-                       const std::array<uint8_t, maxSeedSize>& seed,
-                       const std::string& rawData);
-    bool isMatch(const std::array<uint8_t, maxHashSize>& expected,
-                 const std::array<uint8_t, maxSeedSize>& seed,
-                 const std::string& rawData, const std::string& algo);
-    bool getParam(std::array<uint8_t, maxHashSize>& orgUsrPwdHash,
-                  std::array<uint8_t, maxHashSize>& orgAdminPwdHash,
-                  std::array<uint8_t, maxSeedSize>& seed,
-                  std::string& hashAlgo);
-    bool verifyIntegrityCheck(std::string& newPassword,
-                              std::array<uint8_t, maxSeedSize>& seed,
-                              unsigned int mdLen, const EVP_MD* digestFunc);
+    static bool compareDigest(const KdfParams& kdf, const Hash& expected,
+                              const Seed& seed, const std::string& rawData);
+    static bool isMatch(const Hash& expected, const Seed& seed,
+                        const std::string& rawData, const KdfParams& kdf);
+    static bool verifyIntegrityCheck(const std::string& newPassword,
+                                     const Seed& seed, const KdfParams& kdf,
+                                     Hash& newHash);
+
+    /** @brief Find the cost of new hashes on the worker pool, see
+     *         bios_config_pwd::calibrate.
+     *
+     *  @param[in] algorithm - algorithm of the new hashes
+     */
+    void calibrateKdf(const std::string& algorithm);
+
+    /** @struct FileStamp
+     *
+     *  @brief Identity and version of a file. Writers replacing the file, or
+     *         rewriting it in place, change at least one field.
+     */
+    struct FileStamp
+    {
+        dev_t device = 0;
+        ino_t inode = 0;
+        off_t size = 0;
+        int64_t mtimeSec = 0;
+        int64_t mtimeNsec = 0;
+
+        bool operator==(const FileStamp&) const = default;
+
+        /** @brief Stamp of a file, nullopt if it does not exist. */
+        static std::optional<FileStamp> of(const std::filesystem::path& path);
+    };
+
+    /** @struct SeedData
+     *
+     *  @brief Loaded password record. The whole seed data document is kept
+     *         so that the fields this service does not use are written back
+     *         unchanged.
+     */
+    struct SeedData
+    {
+        PasswordRecord record;
+        nlohmann::json document;
+    };
+
+    /** @brief The seed data. The seed data file is read again only when it
+     *         changed since it was last looked at, e.g. because the BIOS
+     *         provisioning path wrote it. The password store is read only
+     *         when the file is missing or cannot be parsed. While a change
+     *         is not written yet, the change is returned as it is and a new
+     *         seed data file is not read.
+     *
+     *  @return The seed data, nullptr if there is none or it is corrupted.
+     */
+    const SeedData* loadSeedData();
+
+    /** @brief Read the seed data file.
+     *
+     *  @return false if it cannot be parsed.
+     */
+    bool importSeedFile();
+
+    /** @brief Read the password store.
+     */
+    void readStore();
+
+    /** @brief Hand the changed seed data to the writer thread. Called
+     *         directly on a change, and by the persist scheduler to retry a
+     *         write that failed.
+     */
+    void writeSeedData();
+
+    /** @brief Completion of a write of the seed data file or the store.
+     *
+     *  @param[in] ok - whether the file was replaced
+     *  @param[in] file - the file written
+     */
+    void seedDataWritten(bool ok, const std::filesystem::path& file);
+
+    /** @brief Seed data file in the JSON format, shared with the BIOS
+     *         provisioning path and the IPMI OEM commands
+     */
     std::filesystem::path seedFile;
-    std::array<uint8_t, maxHashSize> mNewPwdHash;
+    /** @brief Binary copy of the seed data, read when the seed data file
+     *         is missing or torn
+     */
+    std::filesystem::path storeFile;
+    std::optional<SeedData> seedData;
+    /** @brief seedData holds a change the seed data file or the store does
+     *         not have yet
+     */
+    bool unsavedSeedFile = false;
+    bool unsavedStore = false;
+    /** @brief Writes of either file submitted and not completed */
+    size_t seedWritesInFlight = 0;
+    /** @brief A write of the seed data file completed since the writes
+     *         were last all done
+     */
+    bool wroteSeedFile = false;
+    /** @brief Seed data file last read or written */
+    std::optional<FileStamp> seenSeedFile;
+    /** @brief Key derivation of new hashes once calibrated, until then new
+     *         hashes keep the one of the hash they replace.
+     */
+    std::optional<KdfParams> newHashKdf;
+    AdmissionControl admission{callerPasswordLimits, targetPasswordLimits};
+    bios_config::PersistScheduler& scheduler;
+    bios_config::PersistScheduler::WriterId writerId;
+    bios_config::Metrics& metrics;
+    std::shared_ptr<sdbusplus::asio::dbus_interface> iface;
+
+    /** @brief Runs the key derivations, joined before anything else of the
+     *         object is destroyed.
+     */
+    bios_config::WorkerPool workers;
 };
 
 } // namespace bios_config_pwd
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+
+namespace bios_config_pwd
+{
+
+/** @class AdmissionControl
+ *
+ *  @brief Decides whether a password change may run its key derivations.
+ *
+ *  Every caller and every password a change can target, the admin or the
+ *  user one, has a token bucket, a change takes a token from both and is
+ *  refused while either is empty. Wrong passwords lock the caller and the
+ *  target out for a time that doubles with each further failure, a
+ *  successful change clears the failures. The decision only looks up two
+ *  small maps, so a client looping on wrong passwords is turned away long
+ *  before it can keep the workers busy. A client that reconnects gets a
+ *  new bus name, and a new caller bucket, but still drains the bucket of
+ *  the target.
+ */
+class AdmissionControl
+{
+  public:
+    using Clock = std::chrono::steady_clock;
+
+    enum class Decision
+    {
+        admitted,
+        rateLimited,
+        lockedOut,
+    };
+
+    /** @struct Limits
+     *
+     *  @brief Size of a token bucket and the time it takes to earn back one
+     *         token.
+     */
+    struct Limits
+    {
+        double burst;
+        Clock::duration refill;
+    };
+
+    AdmissionControl(Limits callerLimits, Limits targetLimits) :
+        callerLimits(callerLimits), targetLimits(targetLimits)
+    {}
+
+    /** @brief Take a token for a password change.
+     *
+     *  @param[in] caller - unique bus name of the caller
+     *  @param[in] target - password the change targets, "admin" or "user"
+     *  @param[in] now - current time
+     */
+    Decision admit(const std::string& caller, const std::string& target,
+                   Clock::time_point now = Clock::now());
+
+    /** @brief Record a wrong current password.
+     */
+    void recordFailure(const std::string& caller, const std::string& target,
+                       Clock::time_point now = Clock::now());
+
+    /** @brief Record a successful password change.
+     */
+    void recordSuccess(const std::string& caller, const std::string& target);
+
+  private:
+    struct State
+    {
+        double tokens = 0;
+        Clock::time_point refilled;
+        uint32_t failures = 0;
+        Clock::time_point lockedUntil;
+    };
+
+    using States = std::unordered_map<std::string, State>;
+
+    /** @brief State of a key, a new one starts with a full bucket. */
+    static State& state(States& states, const Limits& limits,
+                        const std::string& key, Clock::time_point now);
+
+    static void refill(State& state, const Limits& limits,
+                       Clock::time_point now);
+
+    static void lockOut(State& state, Clock::time_point now);
+
+    static void clearFailures(States& states, const std::string& key);
+
+    /** @brief Forget the keys that are back to a fresh state once there
+     *         are too many of them. Keys with failures are kept, forgetting
+     *         them would lift their lockout.
+     */
+    static void prune(States& states, const Limits& limits,
+                      Clock::time_point now);
+
+    Limits callerLimits;
+    Limits targetLimits;
+    States callers;
+    States targets;
+};
+
+} // namespace bios_config_pwd
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <string>
+
+namespace bios_config_pwd
+{
+
+/** @brief PBKDF2 iteration count of the hashes that do not record theirs.
+ */
+constexpr int iterValue = 1000;
+
+/** @brief Most PBKDF2 iterations, OpenSSL takes the count as an int. */
+constexpr uint32_t maxIterations = std::numeric_limits<int>::max();
+
+/** @brief scrypt parallelism parameter p of the hashes that do not record
+ *         theirs.
+ */
+constexpr uint32_t scryptParallelism = 1;
+
+/** @brief Largest memory a scrypt derivation may use. */
+constexpr uint64_t maxScryptMemory = 64 * 1024 * 1024;
+
+/** @brief scrypt block size parameter r. */
+constexpr uint64_t scryptBlockSize = 8;
+
+/** @struct KdfParams
+ *
+ *  @brief Key derivation a password hash was computed with.
+ *
+ *  "SHA256", "SHA384" and "SHA512" are PBKDF2-HMAC with the digest, taking
+ *  iterations rounds, at most maxIterations. "SCRYPT" is scrypt with
+ *  N = memoryCost, r = 8 and p = iterations.
+ */
+struct KdfParams
+{
+    std::string algorithm;
+    uint32_t iterations = iterValue;
+    uint64_t memoryCost = 0;
+
+    bool operator==(const KdfParams&) const = default;
+};
+
+/** @brief Iterations of an algorithm whose hashes do not record theirs.
+ *
+ *  @return iterValue for PBKDF2, scryptParallelism for scrypt.
+ */
+uint32_t defaultIterations(const std::string& algorithm);
+
+/** @brief Length of the hashes derived with an algorithm.
+ *
+ *  @return The length in bytes, 0 if the algorithm is not supported.
+ */
+size_t hashLength(const std::string& algorithm);
+
+/** @brief Derive the hash of a password. The terminating null character is
+ *         part of the derived password, as the BIOS hashes it.
+ *
+ *  @param[in] params - key derivation
+ *  @param[in] password - password
+ *  @param[in] seed - salt
+ *  @param[out] hash - hashLength(params.algorithm) bytes of hash
+ *
+ *  @return false if the algorithm is not supported, the parameters are
+ *          invalid or the derivation failed.
+ */
+bool deriveKey(const KdfParams& params, const std::string& password,
+               std::span<const uint8_t> seed, std::span<uint8_t> hash);
+
+/** @brief Find the highest cost of an algorithm whose derivation fits in a
+ *         latency budget on this BMC, by timing derivations. Takes a few
+ *         times the budget to run.
+ *
+ *  @param[in] algorithm - supported algorithm
+ *  @param[in] budget - longest a derivation may take
+ *
+ *  @return The parameters, never cheaper than iterValue iterations for
+ *          PBKDF2 or N = 2^10 for scrypt, and never beyond maxIterations
+ *          or maxScryptMemory whatever the budget.
+ */
+KdfParams calibrate(const std::string& algorithm,
+                    std::chrono::milliseconds budget);
+
+} // namespace bios_config_pwd
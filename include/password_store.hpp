@@ -0,0 +1,99 @@
+#pragma once
+
+#include "password_kdf.hpp"
+
+#include <nlohmann/json.hpp>
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace bios_config_pwd
+{
+
+constexpr uint8_t maxHashSize = 64;
+constexpr uint8_t maxSeedSize = 32;
+
+using Hash = std::array<uint8_t, maxHashSize>;
+using Seed = std::array<uint8_t, maxSeedSize>;
+
+/** @struct SeedParams
+ *
+ *  @brief Stored hashes, seed and hash algorithm of the seed data.
+ */
+struct SeedParams
+{
+    Hash userPwdHash{};
+    Hash adminPwdHash{};
+    Seed seed{};
+    KdfParams userKdf;
+    KdfParams adminKdf;
+
+    bool operator==(const SeedParams&) const = default;
+};
+
+/** @struct PasswordRecord
+ *
+ *  @brief Everything persisted about the BIOS passwords.
+ */
+struct PasswordRecord
+{
+    SeedParams params;
+    bool isAdminPwdChanged = false;
+    bool isUserPwdChanged = false;
+
+    bool operator==(const PasswordRecord&) const = default;
+};
+
+namespace password_store
+{
+
+/** @brief First bytes of a password store file.
+ *
+ *  The store is a single fixed-size record in host byte order, the file
+ *  never leaves the BMC. The hashes and the seed take their full size, the
+ *  algorithm names are null padded, and a CRC-32 of the preceding bytes
+ *  ends the record, so a torn or corrupted file is detected instead of
+ *  being read as wrong hashes.
+ */
+static constexpr std::array<char, 8> magic = {'B', 'I', 'O', 'S',
+                                              'P', 'W', 'D', '\0'};
+static constexpr uint32_t version = 1;
+
+/** @brief Longest algorithm name a record can hold. */
+constexpr size_t maxAlgorithmLength = 15;
+
+/** @brief Encode a record.
+ */
+std::string encode(const PasswordRecord& record);
+
+/** @brief Decode a record.
+ *
+ *  @param[in] data - content of a password store file
+ *
+ *  @return The record. Throws std::runtime_error if the data is not a
+ *          record of this version or its checksum does not match.
+ */
+PasswordRecord decode(std::string_view data);
+
+/** @brief Read a record from a seed data file in the JSON format the BIOS
+ *         provisioning path exchanges. A null document is an empty record.
+ *
+ *  @return The record. Throws nlohmann exceptions if fields are missing or
+ *          malformed, std::runtime_error if an algorithm name is too long
+ *          or an iteration count too large.
+ */
+PasswordRecord fromJson(const nlohmann::json& document);
+
+/** @brief Write a record into a seed data document. The fields the record
+ *         does not hold are left as they are, a hash whose key derivation
+ *         is the one of the document gets no parameters of its own.
+ *
+ *  @param[in] record - record to write
+ *  @param[in,out] document - seed data, null for a new one
+ */
+void toJson(const PasswordRecord& record, nlohmann::json& document);
+
+} // namespace password_store
+} // namespace bios_config_pwd
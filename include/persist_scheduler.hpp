@@ -0,0 +1,125 @@
+#pragma once
+
+#include "file_writer.hpp"
+#include "metrics.hpp"
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <sdbusplus/asio/object_server.hpp>
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace bios_config
+{
+
+static constexpr auto persistObjectPath =
+    "/xyz/openbmc_project/bios_config/persistence";
+static constexpr auto persistInterface =
+    "xyz.openbmc_project.BIOSConfig.Persistence";
+
+/** @class PersistScheduler
+ *
+ *  @brief Coalesces bursts of state changes into group commits.
+ *
+ *  Objects register a writer that persists their state and mark themselves
+ *  dirty on every change instead of writing synchronously. Dirty writers are
+ *  run once the commit window expires or once the number of changes waiting
+ *  reaches the configured limit, whichever comes first. Writers only encode
+ *  the state and hand it to the FileWriter, which performs the I/O on its
+ *  own thread.
+ */
+class PersistScheduler
+{
+  public:
+    using Writer = std::function<void()>;
+    using WriterId = size_t;
+
+    PersistScheduler() = delete;
+    ~PersistScheduler() = default;
+    PersistScheduler(const PersistScheduler&) = delete;
+    PersistScheduler& operator=(const PersistScheduler&) = delete;
+    PersistScheduler(PersistScheduler&&) = delete;
+    PersistScheduler& operator=(PersistScheduler&&) = delete;
+
+    /** @brief Constructs PersistScheduler object.
+     *
+     *  @param[in] io - io context the commits are run on
+     *  @param[in] objectServer - object server
+     *  @param[in] window - time a change may wait before it is persisted
+     *  @param[in] maxPending - number of changes that forces a commit
+     *  @param[in] metrics - metrics recording the time taken by the writes
+     */
+    PersistScheduler(boost::asio::io_context& io,
+                     sdbusplus::asio::object_server& objectServer,
+                     std::chrono::milliseconds window, size_t maxPending,
+                     Metrics& metrics);
+
+    /** @brief Register a writer that persists the state of an object.
+     *
+     *  @param[in] writer - function writing the state to persistent storage
+     *
+     *  @return Identifier to pass to markDirty
+     */
+    WriterId registerWriter(Writer writer);
+
+    /** @brief Note that the state persisted by the writer has changed.
+     *
+     *  @param[in] id - writer identifier
+     */
+    void markDirty(WriterId id);
+
+    /** @brief Run all the dirty writers now.
+     */
+    void flush();
+
+    /** @brief Run all the dirty writers and wait until everything they
+     *         handed over is on persistent storage.
+     */
+    void sync();
+
+    /** @brief Writer thread performing the I/O for the writers.
+     */
+    FileWriter& files()
+    {
+        return fileWriter;
+    }
+
+    /** @brief Number of changes that were absorbed by a later write.
+     */
+    uint64_t coalescedWrites() const
+    {
+        return coalesced;
+    }
+
+    /** @brief Number of times a writer actually ran.
+     */
+    uint64_t physicalWrites() const
+    {
+        return physical;
+    }
+
+  private:
+    struct Slot
+    {
+        Writer writer;
+        bool dirty = false;
+    };
+
+    boost::asio::steady_timer timer;
+    std::shared_ptr<sdbusplus::asio::dbus_interface> iface;
+    std::chrono::milliseconds window;
+    size_t maxPending;
+    Metrics& metrics;
+    FileWriter fileWriter;
+    std::vector<Slot> slots;
+    size_t pendingChanges = 0;
+    bool armed = false;
+    uint64_t coalesced = 0;
+    uint64_t physical = 0;
+};
+
+} // namespace bios_config
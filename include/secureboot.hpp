@@ -1,5 +1,8 @@
 #pragma once
 
+#include "metrics.hpp"
+#include "persist_scheduler.hpp"
+
 #include <cereal/access.hpp>
 #include <cereal/cereal.hpp>
 #include <phosphor-logging/lg2.hpp>
@@ -36,10 +39,13 @@ class SecureBoot : public SecureBootBase
      *  @param[in] objectServer  - object server
      *  @param[in] systemBus - bus connection
      *  @param[in] persistPath - path to the secureboot data file
+     *  @param[in] scheduler - scheduler of the writes to the data file
+     *  @param[in] metrics - metrics recording the time taken by the setters
      */
     SecureBoot(sdbusplus::asio::object_server& objectServer,
                std::shared_ptr<sdbusplus::asio::connection>& systemBus,
-               std::string persistPath);
+               std::string persistPath, PersistScheduler& scheduler,
+               Metrics& metrics);
 
     /** @brief Indicates the UEFI Secure Boot state during the current boot
      * cycle
@@ -70,6 +76,9 @@ class SecureBoot : public SecureBootBase
     sdbusplus::asio::object_server& objServer;
     std::shared_ptr<sdbusplus::asio::connection>& systemBus;
     std::filesystem::path secureBootFile;
+    PersistScheduler& scheduler;
+    PersistScheduler::WriterId writerId;
+    Metrics& metrics;
 
     friend class cereal::access;
 
@@ -114,11 +123,13 @@ class SecureBoot : public SecureBootBase
             modeValue, true);
     }
 
-    /** @brief Serialize the SecureBoot object to the persistent storage
+    /** @brief Serialize the SecureBoot object and hand it to the writer
+     *         thread, which replaces the persisted file
      */
     void serialize();
 
-    /** @brief Deserialize the SecureBoot object from the persistent storage
+    /** @brief Deserialize the SecureBoot object from the persistent storage.
+     *         A file that cannot be loaded is renamed to <path>.corrupt.
      *
      *  @return On success, return true
      *  @return On failure, return false
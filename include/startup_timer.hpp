@@ -0,0 +1,74 @@
+#pragma once
+
+#include <sdbusplus/asio/object_server.hpp>
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+
+namespace bios_config
+{
+
+static constexpr auto startupObjectPath =
+    "/xyz/openbmc_project/bios_config/startup";
+static constexpr auto startupInterface =
+    "xyz.openbmc_project.BIOSConfig.Startup";
+
+/** @class StartupTimer
+ *
+ *  @brief Times the phases of the daemon startup and reports readiness.
+ *
+ *  Each phase lasts from the end of the previous one, or from the
+ *  construction of the timer, until it is ended. Durations are taken from
+ *  the monotonic clock.
+ */
+class StartupTimer
+{
+  public:
+    /** @enum Phases of the startup, in the order they run */
+    enum class Phase : uint8_t
+    {
+        requestName = 0,
+        manager,
+        password,
+        secureBoot,
+    };
+
+    StartupTimer();
+    ~StartupTimer() = default;
+    StartupTimer(const StartupTimer&) = delete;
+    StartupTimer& operator=(const StartupTimer&) = delete;
+    StartupTimer(StartupTimer&&) = delete;
+    StartupTimer& operator=(StartupTimer&&) = delete;
+
+    /** @brief End a phase of the startup.
+     *
+     *  @param[in] phase - phase that just completed
+     */
+    void end(Phase phase);
+
+    /** @brief Log the phase durations in one record, publish them as D-Bus
+     *         properties and notify systemd that the service is ready.
+     *
+     *  @param[in] objectServer - object server
+     */
+    void ready(sdbusplus::asio::object_server& objectServer);
+
+  private:
+    using Clock = std::chrono::steady_clock;
+
+    /** @brief Duration of a phase in microseconds */
+    uint64_t duration(Phase phase) const
+    {
+        return durations[static_cast<uint8_t>(phase)].count();
+    }
+
+    Clock::time_point start;
+    Clock::time_point last;
+    std::array<std::chrono::microseconds, 4> durations{};
+    std::chrono::microseconds total{};
+    std::shared_ptr<sdbusplus::asio::dbus_interface> iface;
+};
+
+} // namespace bios_config
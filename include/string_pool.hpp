@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace bios_config
+{
+
+/** @brief Identifier of a string interned in a StringPool */
+enum class StringId : uint32_t
+{
+};
+
+/** @class StringPool
+ *
+ *  @brief Holds one copy of every distinct string it is given.
+ *
+ *  BIOS tables repeat the same menu paths and enumeration option names
+ *  across thousands of attributes; interning them lets every attribute
+ *  refer to a shared copy through a 32-bit identifier.
+ */
+class StringPool
+{
+  public:
+    /** @brief Add a string to the pool.
+     *
+     *  @param[in] value - string to intern
+     *
+     *  @return Identifier of the pooled copy of the string
+     */
+    StringId intern(std::string_view value);
+
+    /** @brief Look up a string without adding it.
+     *
+     *  @param[in] value - string to look up
+     *
+     *  @return Identifier of the pooled string, nullopt if it is not pooled
+     */
+    std::optional<StringId> find(std::string_view value) const;
+
+    /** @brief Access an interned string.
+     *
+     *  @param[in] id - identifier returned by intern
+     */
+    const std::string& get(StringId id) const
+    {
+        return strings[static_cast<uint32_t>(id)];
+    }
+
+    /** @brief Drop every string in the pool.
+     */
+    void clear();
+
+    /** @brief Number of distinct strings in the pool.
+     */
+    size_t size() const
+    {
+        return strings.size();
+    }
+
+    /** @brief Number of characters held by the pool.
+     */
+    size_t characters() const
+    {
+        return totalCharacters;
+    }
+
+  private:
+    /** @brief Strings never move once added, so the index can refer to them
+     *         by view.
+     */
+    std::deque<std::string> strings;
+    std::unordered_map<std::string_view, StringId> index;
+    size_t totalCharacters = 0;
+};
+
+} // namespace bios_config
@@ -0,0 +1,139 @@
+#pragma once
+
+#include <boost/asio/async_result.hpp>
+#include <boost/asio/error.hpp>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/post.hpp>
+#include <boost/asio/posix/stream_descriptor.hpp>
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace bios_config
+{
+
+/** @class WorkerPool
+ *
+ *  @brief Runs CPU bound jobs, like a password key derivation, on a fixed
+ *         set of worker threads.
+ *
+ *  The D-Bus handlers all run on the single io context thread, so a job
+ *  taking tens of milliseconds there holds up every other request. Jobs are
+ *  run on the workers instead and their completion is run back on the io
+ *  context; the io context is built without thread support, so the workers
+ *  signal completions on an eventfd rather than posting to it. The queue is
+ *  bounded: once it is full new jobs are refused instead of waiting behind
+ *  an arbitrary backlog.
+ */
+class WorkerPool
+{
+  public:
+    using Job = std::function<void()>;
+    using Done = std::function<void()>;
+
+    WorkerPool() = delete;
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+    WorkerPool(WorkerPool&&) = delete;
+    WorkerPool& operator=(WorkerPool&&) = delete;
+
+    /** @brief Constructs WorkerPool object and starts the workers.
+     *
+     *  @param[in] io - io context the completions are run on
+     *  @param[in] threads - number of workers
+     *  @param[in] maxQueued - largest number of jobs waiting for a worker
+     */
+    WorkerPool(boost::asio::io_context& io, size_t threads, size_t maxQueued);
+
+    /** @brief Stops the workers once they finish the jobs they are running.
+     *         Queued jobs and completions that have not run yet are dropped.
+     */
+    ~WorkerPool();
+
+    /** @brief Queue a job.
+     *
+     *  @param[in] job - run on a worker
+     *  @param[in] done - run on the io context once the job has run
+     *
+     *  @return false if the queue is full, the job is not run.
+     */
+    bool submit(Job job, Done done);
+
+    /** @brief Run a job and complete a handler or coroutine once it has run,
+     *         e.g. workers.run(job, yield[ec]) in a D-Bus method taking a
+     *         yield_context.
+     *
+     *  @param[in] job - run on a worker
+     *  @param[in] token - completion token, completed with
+     *                     boost::asio::error::no_buffer_space if the queue
+     *                     is full
+     */
+    template <typename CompletionToken>
+    auto run(Job job, CompletionToken&& token)
+    {
+        return boost::asio::async_initiate<CompletionToken,
+                                           void(boost::system::error_code)>(
+            [this](auto handler, Job job) {
+                // Done must be copyable, the handler may not be
+                auto shared =
+                    std::make_shared<decltype(handler)>(std::move(handler));
+                auto complete = [this, shared](boost::system::error_code ec) {
+                    boost::asio::post(io, [shared, ec]() { (*shared)(ec); });
+                };
+                if (!submit(std::move(job), [complete]() { complete({}); }))
+                {
+                    complete(boost::asio::error::no_buffer_space);
+                }
+            },
+            token, std::move(job));
+    }
+
+    /** @brief Number of jobs queued or running.
+     */
+    size_t inFlight() const;
+
+  private:
+    struct Task
+    {
+        Job job;
+        Done done;
+    };
+
+    /** @brief Worker thread: run the queued jobs. */
+    void work();
+
+    /** @brief Wait for the workers to signal completed jobs. */
+    void waitCompletions();
+
+    /** @brief Run the completions of the jobs run so far. */
+    void runCompletions();
+
+    boost::asio::io_context& io;
+    const size_t maxQueued;
+
+    mutable std::mutex mutex;
+    std::condition_variable wakeWorker;
+
+    /** @brief Jobs waiting for a worker, guarded by mutex */
+    std::deque<Task> queued;
+    /** @brief Completions of the jobs run, guarded by mutex */
+    std::vector<Done> completed;
+    /** @brief Jobs being run, guarded by mutex */
+    size_t running = 0;
+    bool stopping = false;
+
+    /** @brief eventfd the workers signal completed jobs on */
+    boost::asio::posix::stream_descriptor event;
+    int eventFd;
+    uint64_t eventCount = 0;
+
+    std::vector<std::thread> workers;
+};
+
+} // namespace bios_config
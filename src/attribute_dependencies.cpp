@@ -0,0 +1,241 @@
+#include "attribute_dependencies.hpp"
+
+#include <nlohmann/json.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <stdexcept>
+
+namespace bios_config
+{
+
+/** @brief Read the value a condition compares with.
+ */
+static AttributeDependencies::Value conditionValue(const nlohmann::json& json)
+{
+    if (json.is_string())
+    {
+        return json.get<std::string>();
+    }
+    if (json.is_number_integer())
+    {
+        return json.get<int64_t>();
+    }
+    throw std::invalid_argument("Condition value must be a string or integer");
+}
+
+std::vector<AttributeDependencies::Rule>
+    AttributeDependencies::parse(std::string_view json)
+{
+    auto parsed = nlohmann::json::parse(json, nullptr, false);
+    if (parsed.is_discarded() || !parsed.is_array())
+    {
+        throw std::invalid_argument("Dependencies must be a JSON array");
+    }
+
+    std::vector<Rule> parsedRules;
+    parsedRules.reserve(parsed.size());
+    for (const auto& item : parsed)
+    {
+        if (!item.is_object() || !item.contains("Attribute") ||
+            !item["Attribute"].is_string() || !item.contains("Effect") ||
+            !item["Effect"].is_string())
+        {
+            throw std::invalid_argument(
+                "Dependency needs an Attribute and an Effect");
+        }
+
+        Rule rule;
+        rule.target = item["Attribute"].get<std::string>();
+        const auto effect = item["Effect"].get<std::string>();
+
+        if (effect == "ReadOnly" || effect == "Hidden")
+        {
+            rule.effect = (effect == "ReadOnly") ? Effect::readOnly
+                                                 : Effect::hidden;
+            if (!item.contains("When") || !item["When"].is_string())
+            {
+                throw std::invalid_argument(effect + " needs a When attribute");
+            }
+            rule.source = item["When"].get<std::string>();
+
+            if (item.contains("Equals"))
+            {
+                rule.value = conditionValue(item["Equals"]);
+            }
+            else if (item.contains("NotEquals"))
+            {
+                rule.value = conditionValue(item["NotEquals"]);
+                rule.negate = true;
+            }
+            else
+            {
+                throw std::invalid_argument(
+                    effect + " needs an Equals or NotEquals condition");
+            }
+        }
+        else if (effect == "LowerBound" || effect == "UpperBound")
+        {
+            rule.effect = (effect == "LowerBound") ? Effect::lowerBound
+                                                   : Effect::upperBound;
+            if (!item.contains("From") || !item["From"].is_string())
+            {
+                throw std::invalid_argument(effect + " needs a From attribute");
+            }
+            rule.source = item["From"].get<std::string>();
+        }
+        else
+        {
+            throw std::invalid_argument("Unknown dependency effect " + effect);
+        }
+
+        parsedRules.emplace_back(std::move(rule));
+    }
+
+    return parsedRules;
+}
+
+void AttributeDependencies::assign(std::vector<Rule> newRules)
+{
+    rules = std::move(newRules);
+    bySource.clear();
+    byTarget.clear();
+    states = std::make_shared<States>();
+
+    for (size_t i = 0; i < rules.size(); i++)
+    {
+        bySource[rules[i].source].push_back(i);
+        byTarget[rules[i].target].push_back(i);
+    }
+}
+
+AttributeDependencies::State AttributeDependencies::evaluateTarget(
+    const std::vector<size_t>& targetRules, const Lookup& lookup) const
+{
+    State state;
+    for (auto index : targetRules)
+    {
+        const auto& rule = rules[index];
+
+        // A rule whose source is not in the table does not apply
+        const auto* value = lookup(rule.source);
+        if (value == nullptr)
+        {
+            continue;
+        }
+
+        switch (rule.effect)
+        {
+            case Effect::readOnly:
+                state.readOnly |= ((*value == *rule.value) != rule.negate);
+                break;
+            case Effect::hidden:
+                state.hidden |= ((*value == *rule.value) != rule.negate);
+                break;
+            case Effect::lowerBound:
+                if (const auto* bound = std::get_if<int64_t>(value))
+                {
+                    state.lowerBound =
+                        std::max(state.lowerBound.value_or(*bound), *bound);
+                }
+                break;
+            case Effect::upperBound:
+                if (const auto* bound = std::get_if<int64_t>(value))
+                {
+                    state.upperBound =
+                        std::min(state.upperBound.value_or(*bound), *bound);
+                }
+                break;
+        }
+    }
+    return state;
+}
+
+void AttributeDependencies::evaluateAll(const Lookup& lookup)
+{
+    auto next = std::make_shared<States>();
+    for (const auto& [target, targetRules] : byTarget)
+    {
+        auto state = evaluateTarget(targetRules, lookup);
+        if (state != State{})
+        {
+            next->emplace(target, state);
+        }
+    }
+    states = std::move(next);
+}
+
+std::map<std::string, AttributeDependencies::State>
+    AttributeDependencies::evaluate(
+        const std::vector<std::string_view>& changed,
+        const Lookup& lookup) const
+{
+    std::map<std::string, State> result;
+    for (auto name : changed)
+    {
+        auto readers = bySource.find(name);
+        if (readers == bySource.end())
+        {
+            continue;
+        }
+
+        for (auto index : readers->second)
+        {
+            const auto& target = rules[index].target;
+            if (result.contains(target))
+            {
+                continue;
+            }
+            result.emplace(target,
+                           evaluateTarget(byTarget.find(target)->second,
+                                          lookup));
+        }
+    }
+    return result;
+}
+
+void AttributeDependencies::commit(std::map<std::string, State> newStates,
+                                   bool ownSnapshot)
+{
+    std::erase_if(newStates, [this](const auto& item) {
+        const auto* current = state(item.first);
+        return item.second == (current != nullptr ? *current : State{});
+    });
+    if (newStates.empty())
+    {
+        return;
+    }
+
+    // Readers only get the states through snapshots: once no reader holds
+    // a snapshot of them, no reader can see them change. The fence pairs
+    // with the release of the references the readers dropped.
+    if (states.use_count() == (ownSnapshot ? 2 : 1))
+    {
+        std::atomic_thread_fence(std::memory_order_acquire);
+    }
+    else
+    {
+        states = std::make_shared<States>(*states);
+    }
+
+    for (auto& [target, state] : newStates)
+    {
+        if (state == State{})
+        {
+            states->erase(target);
+        }
+        else
+        {
+            states->insert_or_assign(target, state);
+        }
+    }
+}
+
+const AttributeDependencies::State*
+    AttributeDependencies::state(std::string_view name) const
+{
+    auto iter = states->find(name);
+    return iter == states->end() ? nullptr : &iter->second;
+}
+
+} // namespace bios_config
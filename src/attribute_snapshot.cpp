@@ -0,0 +1,362 @@
+#include "attribute_snapshot.hpp"
+
+#include <algorithm>
+#include <atomic>
+
+namespace bios_config
+{
+
+std::optional<AttributeSnapshot::Lookup>
+    AttributeSnapshot::find(const std::string& name) const
+{
+    if (image)
+    {
+        return image->find(name);
+    }
+
+    const auto* entry = table ? table->find(name) : nullptr;
+    if (entry == nullptr)
+    {
+        return std::nullopt;
+    }
+
+    Lookup lookup{entry->type, entry->currentValue, std::nullopt};
+    if (pending)
+    {
+        auto iter = pending->find(name);
+        if (iter != pending->end())
+        {
+            lookup.pending = iter->second;
+        }
+    }
+
+    return lookup;
+}
+
+std::optional<AttributeSnapshot::State>
+    AttributeSnapshot::state(const std::string& name) const
+{
+    State result;
+    if (image)
+    {
+        auto attribute = image->attribute(name);
+        if (!attribute)
+        {
+            return std::nullopt;
+        }
+
+        const auto& [type, readOnly, displayName, description, menuPath,
+                     currentValue, defaultValue, options] = *attribute;
+        result.readOnly = readOnly;
+        if (type == AttributeStore::AttributeType::Integer)
+        {
+            for (const auto& [boundType, value, valueName] : options)
+            {
+                const auto* number = std::get_if<int64_t>(&value);
+                if (number == nullptr)
+                {
+                    continue;
+                }
+                if (boundType == AttributeStore::BoundType::LowerBound)
+                {
+                    result.lowerBound = *number;
+                }
+                else if (boundType == AttributeStore::BoundType::UpperBound)
+                {
+                    result.upperBound = *number;
+                }
+            }
+        }
+    }
+    else
+    {
+        const auto* entry = table ? table->find(name) : nullptr;
+        if (entry == nullptr)
+        {
+            return std::nullopt;
+        }
+
+        result.readOnly = entry->readOnly;
+        if (entry->type == AttributeStore::AttributeType::Integer)
+        {
+            result.lowerBound = entry->constraint.lowerBound;
+            result.upperBound = entry->constraint.upperBound;
+        }
+    }
+
+    if (!states)
+    {
+        return result;
+    }
+    auto iter = states->find(name);
+    if (iter == states->end())
+    {
+        return result;
+    }
+
+    const auto& dependency = iter->second;
+    result.readOnly |= dependency.readOnly;
+    result.hidden = dependency.hidden;
+    if (dependency.lowerBound)
+    {
+        result.lowerBound = std::max(result.lowerBound, *dependency.lowerBound);
+    }
+    if (dependency.upperBound)
+    {
+        result.upperBound = std::min(result.upperBound, *dependency.upperBound);
+    }
+    return result;
+}
+
+bool AttributeSnapshot::hidden(std::string_view name) const
+{
+    if (!states)
+    {
+        return false;
+    }
+    auto iter = states->find(name);
+    return iter != states->end() && iter->second.hidden;
+}
+
+/** @brief Check whether a dependency hides any attribute.
+ */
+static bool anyHidden(const AttributeSnapshot& snapshot)
+{
+    return snapshot.states &&
+           std::ranges::any_of(*snapshot.states, [](const auto& state) {
+               return state.second.hidden;
+           });
+}
+
+/** @brief Visit every attribute, hidden or not, see forEach.
+ */
+static void forEachAttribute(const AttributeSnapshot& snapshot,
+                             const AttributeSnapshot::Visitor& visit)
+{
+    if (snapshot.image)
+    {
+        snapshot.image->forEach(visit);
+        return;
+    }
+    if (!snapshot.table)
+    {
+        return;
+    }
+
+    // The entries and the pending values are both in name order
+    static const AttributeStore::PendingAttributes none;
+    const auto& pendingAttrs = snapshot.pending ? *snapshot.pending : none;
+    auto next = pendingAttrs.begin();
+    for (const auto& entry : snapshot.table->all())
+    {
+        AttributeSnapshot::Lookup lookup{entry.type, entry.currentValue,
+                                         std::nullopt};
+        while (next != pendingAttrs.end() && next->first < entry.name)
+        {
+            ++next;
+        }
+        if (next != pendingAttrs.end() && next->first == entry.name)
+        {
+            lookup.pending = next->second;
+        }
+
+        visit(entry.name, std::move(lookup));
+    }
+}
+
+void AttributeSnapshot::forEach(const Visitor& visit) const
+{
+    if (!anyHidden(*this))
+    {
+        forEachAttribute(*this, visit);
+        return;
+    }
+
+    forEachAttribute(*this, [this, &visit](std::string_view name,
+                                           Lookup lookup) {
+        if (!hidden(name))
+        {
+            visit(name, std::move(lookup));
+        }
+    });
+}
+
+/** @brief Slice of the BaseBIOSTable, hidden attributes included, see
+ *         tableSlice.
+ */
+static AttributeSnapshot::BaseTable
+    allTableSlice(const AttributeSnapshot& snapshot, std::string_view after,
+                  size_t limit)
+{
+    if (snapshot.image)
+    {
+        return snapshot.image->baseTable(after, limit);
+    }
+
+    AttributeSnapshot::BaseTable slice;
+    if (!snapshot.table)
+    {
+        return slice;
+    }
+
+    const auto& table = *snapshot.table;
+    const auto& entries = table.all();
+    auto entry = entries.begin();
+    if (!after.empty())
+    {
+        entry = std::upper_bound(
+            entries.begin(), entries.end(), after,
+            [](std::string_view name, const AttributeStore::Entry& other) {
+                return name < other.name;
+            });
+    }
+    for (; entry != entries.end() && slice.size() < limit; ++entry)
+    {
+        slice.emplace_hint(slice.end(), entry->name, table.attribute(*entry));
+    }
+    return slice;
+}
+
+/** @brief Slice of the PendingAttributes, hidden attributes included, see
+ *         pendingSlice.
+ */
+static AttributeSnapshot::PendingAttributes
+    allPendingSlice(const AttributeSnapshot& snapshot, std::string_view after,
+                    size_t limit)
+{
+    if (snapshot.image)
+    {
+        return snapshot.image->pendingAttributes(after, limit);
+    }
+
+    AttributeSnapshot::PendingAttributes slice;
+    if (!snapshot.pending)
+    {
+        return slice;
+    }
+
+    const auto& pending = *snapshot.pending;
+    auto iter = after.empty() ? pending.begin()
+                              : pending.upper_bound(std::string(after));
+    for (; iter != pending.end() && slice.size() < limit; ++iter)
+    {
+        slice.emplace_hint(slice.end(), *iter);
+    }
+    return slice;
+}
+
+/** @brief Take a slice leaving out the hidden attributes, slicing further
+ *         until it holds limit attributes or the attributes run out.
+ */
+template <typename Map, typename Slice>
+static Map visibleSlice(const AttributeSnapshot& snapshot,
+                        std::string_view after, size_t limit, Slice slice)
+{
+    Map result;
+    std::string next(after);
+    while (result.size() < limit)
+    {
+        const size_t wanted = limit - result.size();
+        auto part = slice(next, wanted);
+        if (part.empty())
+        {
+            break;
+        }
+        next = part.rbegin()->first;
+
+        const bool exhausted = part.size() < wanted;
+        while (!part.empty())
+        {
+            auto node = part.extract(part.begin());
+            if (!snapshot.hidden(node.key()))
+            {
+                result.insert(result.end(), std::move(node));
+            }
+        }
+        if (exhausted)
+        {
+            break;
+        }
+    }
+    return result;
+}
+
+AttributeSnapshot::BaseTable
+    AttributeSnapshot::tableSlice(std::string_view after, size_t limit) const
+{
+    if (!anyHidden(*this))
+    {
+        return allTableSlice(*this, after, limit);
+    }
+    return visibleSlice<BaseTable>(
+        *this, after, limit, [this](std::string_view from, size_t count) {
+            return allTableSlice(*this, from, count);
+        });
+}
+
+AttributeSnapshot::PendingAttributes
+    AttributeSnapshot::pendingSlice(std::string_view after, size_t limit) const
+{
+    if (!anyHidden(*this))
+    {
+        return allPendingSlice(*this, after, limit);
+    }
+    return visibleSlice<PendingAttributes>(
+        *this, after, limit, [this](std::string_view from, size_t count) {
+            return allPendingSlice(*this, from, count);
+        });
+}
+
+std::shared_ptr<SnapshotPublisher::PendingAttributes>
+    SnapshotPublisher::editPending()
+{
+    const auto& pending = snapshot->pending;
+    if (!pending)
+    {
+        return std::make_shared<PendingAttributes>();
+    }
+
+    // Readers only get snapshots from this thread: once it holds the last
+    // reference to the latest snapshot and to its pending values, no reader
+    // can see them change. The fence pairs with the release of the
+    // references the readers dropped.
+    if (snapshot.use_count() == 1 && pending.use_count() == 1)
+    {
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return std::const_pointer_cast<PendingAttributes>(pending);
+    }
+    return std::make_shared<PendingAttributes>(*pending);
+}
+
+void SnapshotPublisher::publish(
+    std::shared_ptr<const BiosImage> image,
+    std::shared_ptr<const AttributeStore> table,
+    std::shared_ptr<PendingAttributes> pending,
+    std::shared_ptr<const AttributeDependencies::States> states, bool newTable)
+{
+    if (newTable)
+    {
+        tableGeneration++;
+    }
+
+    auto next = std::make_shared<AttributeSnapshot>();
+    next->generation = ++generation;
+    next->tableGeneration = tableGeneration;
+    next->image = std::move(image);
+    next->table = std::move(table);
+    next->pending = std::move(pending);
+    next->states = std::move(states);
+
+    snapshot = std::move(next);
+}
+
+void SnapshotPublisher::publishStates(
+    std::shared_ptr<const AttributeDependencies::States> states)
+{
+    auto next = std::make_shared<AttributeSnapshot>(*snapshot);
+    next->states = std::move(states);
+
+    snapshot = std::move(next);
+}
+
+} // namespace bios_config
@@ -0,0 +1,282 @@
+#include "attribute_store.hpp"
+
+#include <phosphor-logging/lg2.hpp>
+
+#include <algorithm>
+#include <bit>
+#include <functional>
+#include <utility>
+
+namespace bios_config
+{
+
+void AttributeStore::assign(const BaseTable& table)
+{
+    entries.clear();
+    entries.reserve(table.size());
+    menuIndex.clear();
+    pool.clear();
+
+    // Keep the load factor at or below one half so that probe sequences stay
+    // short even for the largest tables.
+    slots.assign(std::bit_ceil(std::max<size_t>(table.size() * 2, 16)),
+                 emptySlot);
+
+    for (const auto& [name, attribute] : table)
+    {
+        auto index = static_cast<uint32_t>(entries.size());
+        slots[probe(name)] = index;
+        entries.push_back(makeEntry(name, attribute));
+        menuIndex.add(pool.get(entries.back().menuPath), index);
+    }
+}
+
+AttributeStore::TableDiff AttributeStore::diff(const BaseTable& table) const
+{
+    TableDiff diff;
+
+    // Both sides are ordered by name, so a single merge pass finds every
+    // difference.
+    auto entry = entries.begin();
+    auto iter = table.begin();
+    while (entry != entries.end() || iter != table.end())
+    {
+        if (iter == table.end() ||
+            (entry != entries.end() && entry->name < iter->first))
+        {
+            diff.removed.push_back(entry->name);
+            ++entry;
+        }
+        else if (entry == entries.end() || iter->first < entry->name)
+        {
+            diff.added.push_back(iter->first);
+            ++iter;
+        }
+        else
+        {
+            const auto& [type, readOnly, displayName, description, menuPath,
+                         currentValue, defaultValue, options] = iter->second;
+            if (entry->currentValue != currentValue ||
+                !sameDefinition(*entry, iter->second))
+            {
+                diff.changed.push_back(iter->first);
+            }
+            ++entry;
+            ++iter;
+        }
+    }
+
+    return diff;
+}
+
+AttributeStore::Entry AttributeStore::makeEntry(const std::string& name,
+                                                const Attribute& attribute)
+{
+    const auto& [type, readOnly, displayName, description, menuPath,
+                 currentValue, defaultValue, options] = attribute;
+
+    Entry entry{.name = name,
+                .type = type,
+                .readOnly = readOnly,
+                .displayName = pool.intern(displayName),
+                .description = pool.intern(description),
+                .menuPath = pool.intern(menuPath),
+                .currentValue = currentValue,
+                .defaultValue = defaultValue,
+                .options = {},
+                .constraint = {}};
+
+    entry.options.reserve(options.size());
+    for (const auto& [boundType, bound, valueName] : options)
+    {
+        StoredOption option{.boundType = boundType,
+                            .value = int64_t{0},
+                            .valueName = pool.intern(valueName)};
+        if (const auto* text = std::get_if<std::string>(&bound))
+        {
+            option.value = pool.intern(*text);
+        }
+        else
+        {
+            option.value = std::get<int64_t>(bound);
+        }
+        entry.options.push_back(option);
+    }
+    entry.constraint = compile(name, entry.options);
+
+    return entry;
+}
+
+bool AttributeStore::sameDefinition(const Entry& entry,
+                                    const Attribute& attribute) const
+{
+    const auto& [type, readOnly, displayName, description, menuPath,
+                 currentValue, defaultValue, options] = attribute;
+
+    if (entry.type != type || entry.readOnly != readOnly ||
+        pool.get(entry.displayName) != displayName ||
+        pool.get(entry.description) != description ||
+        pool.get(entry.menuPath) != menuPath ||
+        entry.defaultValue != defaultValue ||
+        entry.options.size() != options.size())
+    {
+        return false;
+    }
+
+    for (size_t i = 0; i < options.size(); i++)
+    {
+        const auto& stored = entry.options[i];
+        const auto& [boundType, bound, valueName] = options[i];
+
+        if (stored.boundType != boundType ||
+            pool.get(stored.valueName) != valueName ||
+            stored.value.index() != bound.index())
+        {
+            return false;
+        }
+
+        if (const auto* id = std::get_if<StringId>(&stored.value))
+        {
+            if (pool.get(*id) != std::get<std::string>(bound))
+            {
+                return false;
+            }
+        }
+        else if (std::get<int64_t>(stored.value) != std::get<int64_t>(bound))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+AttributeStore::Attribute AttributeStore::attribute(const Entry& entry) const
+{
+    std::vector<Option> options;
+    options.reserve(entry.options.size());
+    for (const auto& stored : entry.options)
+    {
+        Value value;
+        if (const auto* id = std::get_if<StringId>(&stored.value))
+        {
+            value = pool.get(*id);
+        }
+        else
+        {
+            value = std::get<int64_t>(stored.value);
+        }
+        options.emplace_back(stored.boundType, std::move(value),
+                             pool.get(stored.valueName));
+    }
+
+    return {entry.type,
+            entry.readOnly,
+            pool.get(entry.displayName),
+            pool.get(entry.description),
+            pool.get(entry.menuPath),
+            entry.currentValue,
+            entry.defaultValue,
+            std::move(options)};
+}
+
+AttributeStore::Constraint AttributeStore::compile(
+    const std::string& name, const std::vector<StoredOption>& options)
+{
+    Constraint constraint;
+
+    for (const auto& option : options)
+    {
+        if (option.boundType == BoundType::OneOf)
+        {
+            if (const auto* id = std::get_if<StringId>(&option.value))
+            {
+                constraint.oneOf.push_back(*id);
+            }
+            continue;
+        }
+
+        const auto* number = std::get_if<int64_t>(&option.value);
+        if (number == nullptr)
+        {
+            lg2::error("Bound of {NAME} is not an integer", "NAME", name);
+            continue;
+        }
+
+        switch (option.boundType)
+        {
+            case BoundType::LowerBound:
+                constraint.lowerBound = *number;
+                break;
+            case BoundType::UpperBound:
+                constraint.upperBound = *number;
+                break;
+            case BoundType::ScalarIncrement:
+                constraint.scalarIncrement = *number;
+                break;
+            case BoundType::MinStringLength:
+                constraint.minStringLength = static_cast<size_t>(*number);
+                break;
+            case BoundType::MaxStringLength:
+                constraint.maxStringLength = static_cast<size_t>(*number);
+                break;
+            default:
+                break;
+        }
+    }
+
+    std::ranges::sort(constraint.oneOf);
+
+    return constraint;
+}
+
+bool AttributeStore::isOneOf(const Entry& entry, std::string_view value) const
+{
+    // Every option value is interned, so a value that is not in the pool
+    // cannot be one of them and the rest is an identifier comparison.
+    auto id = pool.find(value);
+    return id && std::ranges::binary_search(entry.constraint.oneOf, *id);
+}
+
+size_t AttributeStore::probe(std::string_view name) const
+{
+    const size_t mask = slots.size() - 1;
+    size_t slot = std::hash<std::string_view>{}(name) & mask;
+
+    while (slots[slot] != emptySlot && entries[slots[slot]].name != name)
+    {
+        slot = (slot + 1) & mask;
+    }
+
+    return slot;
+}
+
+const AttributeStore::Entry* AttributeStore::find(std::string_view name) const
+{
+    if (entries.empty())
+    {
+        return nullptr;
+    }
+
+    auto index = slots[probe(name)];
+    if (index == emptySlot)
+    {
+        return nullptr;
+    }
+
+    return &entries[index];
+}
+
+AttributeStore::BaseTable AttributeStore::baseTable() const
+{
+    // Entries are stored in name order, so every insert lands at the end.
+    BaseTable table;
+    for (const auto& entry : entries)
+    {
+        table.emplace_hint(table.end(), entry.name, attribute(entry));
+    }
+
+    return table;
+}
+
+} // namespace bios_config
@@ -0,0 +1,609 @@
+#include "bios_image.hpp"
+
+#include "compression.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+#include <stdexcept>
+#include <system_error>
+#include <type_traits>
+
+namespace bios_config
+{
+
+struct BiosImage::Header
+{
+    std::array<char, 8> magic;
+    uint32_t version;
+    uint32_t attributeCount;
+    uint32_t optionCount;
+    uint32_t pendingCount;
+    uint64_t attributesOffset;
+    uint64_t optionsOffset;
+    uint64_t pendingOffset;
+    uint64_t stringsOffset;
+    uint64_t stringsSize;
+    uint64_t imageSize;
+};
+
+struct BiosImage::StringRef
+{
+    uint32_t offset;
+    uint32_t length;
+};
+
+struct BiosImage::ValueRecord
+{
+    uint32_t isString;
+    StringRef string;
+    uint32_t reserved;
+    int64_t integer;
+};
+
+struct BiosImage::AttributeRecord
+{
+    StringRef name;
+    StringRef displayName;
+    StringRef description;
+    StringRef menuPath;
+    ValueRecord currentValue;
+    ValueRecord defaultValue;
+    uint32_t firstOption;
+    uint32_t optionCount;
+    uint32_t type;
+    uint32_t readOnly;
+};
+
+struct BiosImage::OptionRecord
+{
+    ValueRecord value;
+    StringRef valueName;
+    uint32_t boundType;
+    uint32_t reserved;
+};
+
+struct BiosImage::PendingRecord
+{
+    StringRef name;
+    uint32_t type;
+    uint32_t reserved;
+    ValueRecord value;
+};
+
+/** @brief Check that a stored attribute type is one of the enumerators, the
+ *         records are cast to the enumeration when they are decoded.
+ */
+static bool isAttributeType(uint32_t type)
+{
+    using AttributeType = BiosImage::AttributeType;
+    switch (static_cast<AttributeType>(type))
+    {
+        case AttributeType::Enumeration:
+        case AttributeType::String:
+        case AttributeType::Password:
+        case AttributeType::Integer:
+        case AttributeType::Boolean:
+            return true;
+        default:
+            return false;
+    }
+}
+
+/** @brief Check that a stored bound type is one of the enumerators.
+ */
+static bool isBoundType(uint32_t boundType)
+{
+    using BoundType = AttributeStore::BoundType;
+    switch (static_cast<BoundType>(boundType))
+    {
+        case BoundType::LowerBound:
+        case BoundType::UpperBound:
+        case BoundType::ScalarIncrement:
+        case BoundType::MinStringLength:
+        case BoundType::MaxStringLength:
+        case BoundType::OneOf:
+            return true;
+        default:
+            return false;
+    }
+}
+
+/** @brief Append the bytes of trivially copyable objects to a buffer.
+ */
+template <typename T>
+static void append(std::string& out, const T* objects, size_t count)
+{
+    out.append(reinterpret_cast<const char*>(objects), count * sizeof(T));
+}
+
+std::string BiosImage::encode(const BaseTable& table,
+                              const PendingAttributes& pending)
+{
+    // The records are copied to and from the file as they are, so they must
+    // not have padding, and nameAt() reads the name of either kind of record
+    // the same way.
+    static_assert(sizeof(Header) == 72);
+    static_assert(sizeof(ValueRecord) == 24);
+    static_assert(sizeof(AttributeRecord) == 96);
+    static_assert(sizeof(OptionRecord) == 40);
+    static_assert(sizeof(PendingRecord) == 40);
+    static_assert(offsetof(AttributeRecord, name) == 0);
+    static_assert(offsetof(PendingRecord, name) == 0);
+    static_assert(std::is_trivially_copyable_v<AttributeRecord>);
+
+    // Every distinct string is stored once, at the offset it had when it was
+    // first interned.
+    StringPool pool;
+    std::vector<uint32_t> offsets;
+    auto ref = [&pool, &offsets](std::string_view str) {
+        const size_t before = pool.characters();
+        if (before + str.size() > UINT32_MAX)
+        {
+            throw std::length_error("BIOS image strings exceed 4 GiB");
+        }
+
+        auto id = static_cast<uint32_t>(pool.intern(str));
+        if (id == offsets.size())
+        {
+            offsets.push_back(static_cast<uint32_t>(before));
+        }
+        return StringRef{offsets[id], static_cast<uint32_t>(str.size())};
+    };
+    auto valueRecord = [&ref](const Value& value) {
+        ValueRecord record{};
+        if (const auto* str = std::get_if<std::string>(&value))
+        {
+            record.isString = 1;
+            record.string = ref(*str);
+        }
+        else
+        {
+            record.integer = std::get<int64_t>(value);
+        }
+        return record;
+    };
+
+    std::vector<AttributeRecord> attributeRecords;
+    std::vector<OptionRecord> optionRecords;
+    attributeRecords.reserve(table.size());
+    for (const auto& [name, attr] : table)
+    {
+        const auto& [type, readOnly, displayName, description, menuPath,
+                     currentValue, defaultValue, attrOptions] = attr;
+
+        AttributeRecord record{};
+        record.name = ref(name);
+        record.displayName = ref(displayName);
+        record.description = ref(description);
+        record.menuPath = ref(menuPath);
+        record.currentValue = valueRecord(currentValue);
+        record.defaultValue = valueRecord(defaultValue);
+        record.firstOption = static_cast<uint32_t>(optionRecords.size());
+        record.optionCount = static_cast<uint32_t>(attrOptions.size());
+        record.type = static_cast<uint32_t>(type);
+        record.readOnly = readOnly ? 1 : 0;
+        attributeRecords.push_back(record);
+
+        for (const auto& [boundType, value, valueName] : attrOptions)
+        {
+            OptionRecord option{};
+            option.value = valueRecord(value);
+            option.valueName = ref(valueName);
+            option.boundType = static_cast<uint32_t>(boundType);
+            optionRecords.push_back(option);
+        }
+    }
+
+    std::vector<PendingRecord> pendingRecords;
+    pendingRecords.reserve(pending.size());
+    for (const auto& [name, attr] : pending)
+    {
+        PendingRecord record{};
+        record.name = ref(name);
+        record.type = static_cast<uint32_t>(std::get<0>(attr));
+        record.value = valueRecord(std::get<1>(attr));
+        pendingRecords.push_back(record);
+    }
+
+    Header header{};
+    header.magic = magic;
+    header.version = version;
+    header.attributeCount = static_cast<uint32_t>(attributeRecords.size());
+    header.optionCount = static_cast<uint32_t>(optionRecords.size());
+    header.pendingCount = static_cast<uint32_t>(pendingRecords.size());
+    header.attributesOffset = sizeof(Header);
+    header.optionsOffset =
+        header.attributesOffset +
+        attributeRecords.size() * sizeof(AttributeRecord);
+    header.pendingOffset =
+        header.optionsOffset + optionRecords.size() * sizeof(OptionRecord);
+    header.stringsOffset =
+        header.pendingOffset + pendingRecords.size() * sizeof(PendingRecord);
+    header.stringsSize = pool.characters();
+    header.imageSize = header.stringsOffset + header.stringsSize;
+
+    std::string image;
+    image.reserve(header.imageSize);
+    append(image, &header, 1);
+    append(image, attributeRecords.data(), attributeRecords.size());
+    append(image, optionRecords.data(), optionRecords.size());
+    append(image, pendingRecords.data(), pendingRecords.size());
+    for (uint32_t id = 0; id < pool.size(); id++)
+    {
+        image += pool.get(static_cast<StringId>(id));
+    }
+
+    return image;
+}
+
+std::unique_ptr<BiosImage> BiosImage::open(const std::filesystem::path& path)
+{
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        throw std::system_error(errno, std::generic_category(),
+                                "Failed to open " + path.string());
+    }
+
+    struct stat st{};
+    if (fstat(fd, &st) != 0)
+    {
+        int error = errno;
+        close(fd);
+        throw std::system_error(error, std::generic_category(),
+                                "Failed to stat " + path.string());
+    }
+
+    auto size = static_cast<size_t>(st.st_size);
+    if (size == 0)
+    {
+        close(fd);
+        return nullptr;
+    }
+
+    void* mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    int error = errno;
+    close(fd);
+    if (mapped == MAP_FAILED)
+    {
+        throw std::system_error(error, std::generic_category(),
+                                "Failed to map " + path.string());
+    }
+
+    std::unique_ptr<BiosImage> image(
+        new BiosImage(static_cast<const char*>(mapped), size));
+    if (compression::isCompressed({image->data, image->fileSize}))
+    {
+        // A compressed image is decoded into memory and the mapping is
+        // released
+        image.reset(
+            new BiosImage(compression::decompress({image->data, size})));
+        if (image->fileSize < sizeof(Header) ||
+            std::memcmp(image->data, magic.data(), magic.size()) != 0)
+        {
+            throw std::runtime_error("Compressed file holds no BIOS image");
+        }
+    }
+    else if (size < sizeof(Header) ||
+             std::memcmp(image->data, magic.data(), magic.size()) != 0)
+    {
+        return nullptr;
+    }
+
+    image->validate();
+    return image;
+}
+
+BiosImage::~BiosImage()
+{
+    if (buffer.empty())
+    {
+        munmap(const_cast<char*>(data), fileSize);
+    }
+}
+
+void BiosImage::validate()
+{
+    Header header{};
+    std::memcpy(&header, data, sizeof(header));
+
+    if (header.version != version)
+    {
+        throw std::runtime_error("Unsupported BIOS image version " +
+                                 std::to_string(header.version));
+    }
+    if (header.imageSize < sizeof(Header) || header.imageSize > fileSize)
+    {
+        throw std::runtime_error("BIOS image size out of bounds");
+    }
+
+    imageSize = header.imageSize;
+    auto section = [this](uint64_t offset, uint64_t count, size_t size) {
+        if (offset > imageSize || count > (imageSize - offset) / size)
+        {
+            throw std::runtime_error("BIOS image section out of bounds");
+        }
+        return Section{offset, count};
+    };
+    attributes = section(header.attributesOffset, header.attributeCount,
+                         sizeof(AttributeRecord));
+    options = section(header.optionsOffset, header.optionCount,
+                      sizeof(OptionRecord));
+    pending = section(header.pendingOffset, header.pendingCount,
+                      sizeof(PendingRecord));
+    strings = section(header.stringsOffset, header.stringsSize, 1);
+
+    // A single sequential pass without allocation, after which lookups and
+    // decoding can trust the records, their enumerators included.
+    auto check = [this](bool valid) {
+        if (!valid)
+        {
+            throw std::runtime_error("BIOS image record out of bounds");
+        }
+    };
+    auto checkValue = [this, &check](const ValueRecord& record) {
+        check(record.isString == 0 || contains(record.string));
+    };
+
+    std::string_view previous;
+    for (size_t i = 0; i < attributes.count; i++)
+    {
+        auto record = read<AttributeRecord>(attributes, i);
+        check(contains(record.name) && contains(record.displayName) &&
+              contains(record.description) && contains(record.menuPath));
+        checkValue(record.currentValue);
+        checkValue(record.defaultValue);
+        check(record.firstOption <= options.count &&
+              record.optionCount <= options.count - record.firstOption);
+        check(isAttributeType(record.type));
+
+        auto name = string(record.name);
+        check(i == 0 || previous < name);
+        previous = name;
+    }
+
+    for (size_t i = 0; i < options.count; i++)
+    {
+        auto record = read<OptionRecord>(options, i);
+        checkValue(record.value);
+        check(contains(record.valueName));
+        check(isBoundType(record.boundType));
+    }
+
+    for (size_t i = 0; i < pending.count; i++)
+    {
+        auto record = read<PendingRecord>(pending, i);
+        check(contains(record.name));
+        checkValue(record.value);
+        check(isAttributeType(record.type));
+
+        auto name = string(record.name);
+        check(i == 0 || previous < name);
+        previous = name;
+    }
+}
+
+template <typename Record>
+Record BiosImage::read(const Section& section, size_t index) const
+{
+    Record record;
+    std::memcpy(&record, data + section.offset + index * sizeof(Record),
+                sizeof(Record));
+    return record;
+}
+
+std::string_view BiosImage::nameAt(const Section& section, size_t recordSize,
+                                   size_t index) const
+{
+    StringRef ref;
+    std::memcpy(&ref, data + section.offset + index * recordSize, sizeof(ref));
+    return string(ref);
+}
+
+size_t BiosImage::lowerBound(const Section& section, size_t recordSize,
+                             std::string_view name) const
+{
+    size_t first = 0;
+    size_t count = section.count;
+    while (count > 0)
+    {
+        size_t step = count / 2;
+        if (nameAt(section, recordSize, first + step) < name)
+        {
+            first += step + 1;
+            count -= step + 1;
+        }
+        else
+        {
+            count = step;
+        }
+    }
+    return first;
+}
+
+size_t BiosImage::sliceStart(const Section& section, size_t recordSize,
+                             std::string_view after) const
+{
+    if (after.empty())
+    {
+        return 0;
+    }
+
+    auto first = lowerBound(section, recordSize, after);
+    if (first < section.count && nameAt(section, recordSize, first) == after)
+    {
+        first++;
+    }
+    return first;
+}
+
+std::optional<size_t> BiosImage::search(
+    const Section& section, size_t recordSize, std::string_view name) const
+{
+    auto first = lowerBound(section, recordSize, name);
+    if (first < section.count && nameAt(section, recordSize, first) == name)
+    {
+        return first;
+    }
+    return std::nullopt;
+}
+
+bool BiosImage::contains(const StringRef& ref) const
+{
+    return ref.offset <= strings.count &&
+           ref.length <= strings.count - ref.offset;
+}
+
+std::string_view BiosImage::string(const StringRef& ref) const
+{
+    return {data + strings.offset + ref.offset, ref.length};
+}
+
+BiosImage::Value BiosImage::value(const ValueRecord& record) const
+{
+    if (record.isString != 0)
+    {
+        return std::string(string(record.string));
+    }
+    return record.integer;
+}
+
+std::optional<BiosImage::Lookup> BiosImage::find(std::string_view name) const
+{
+    auto index = search(attributes, sizeof(AttributeRecord), name);
+    if (!index)
+    {
+        return std::nullopt;
+    }
+
+    auto record = read<AttributeRecord>(attributes, *index);
+    Lookup lookup{static_cast<AttributeType>(record.type),
+                  value(record.currentValue), std::nullopt};
+
+    auto pendingIndex = search(pending, sizeof(PendingRecord), name);
+    if (pendingIndex)
+    {
+        auto pendingRecord = read<PendingRecord>(pending, *pendingIndex);
+        lookup.pending.emplace(static_cast<AttributeType>(pendingRecord.type),
+                               value(pendingRecord.value));
+    }
+
+    return lookup;
+}
+
+void BiosImage::forEach(const Visitor& visit) const
+{
+    // Both sections are sorted by name, the pending records are merged in
+    // as the attributes are walked
+    size_t next = 0;
+    for (size_t i = 0; i < attributes.count; i++)
+    {
+        auto record = read<AttributeRecord>(attributes, i);
+        auto name = string(record.name);
+        Lookup lookup{static_cast<AttributeType>(record.type),
+                      value(record.currentValue), std::nullopt};
+
+        while (next < pending.count)
+        {
+            auto pendingRecord = read<PendingRecord>(pending, next);
+            auto pendingName = string(pendingRecord.name);
+            if (pendingName > name)
+            {
+                break;
+            }
+
+            next++;
+            if (pendingName == name)
+            {
+                lookup.pending.emplace(
+                    static_cast<AttributeType>(pendingRecord.type),
+                    value(pendingRecord.value));
+                break;
+            }
+        }
+
+        visit(name, std::move(lookup));
+    }
+}
+
+BiosImage::BaseTable BiosImage::baseTable(std::string_view after,
+                                          size_t limit) const
+{
+    BaseTable table;
+    auto first = sliceStart(attributes, sizeof(AttributeRecord), after);
+    auto last = first + std::min(limit, attributes.count - first);
+    for (size_t i = first; i < last; i++)
+    {
+        auto record = read<AttributeRecord>(attributes, i);
+        table.emplace_hint(table.end(), string(record.name), decode(record));
+    }
+
+    return table;
+}
+
+std::optional<BiosImage::Attribute>
+    BiosImage::attribute(std::string_view name) const
+{
+    auto index = search(attributes, sizeof(AttributeRecord), name);
+    if (!index)
+    {
+        return std::nullopt;
+    }
+    return decode(read<AttributeRecord>(attributes, *index));
+}
+
+BiosImage::Attribute BiosImage::decode(const AttributeRecord& record) const
+{
+    std::vector<AttributeStore::Option> attrOptions;
+    attrOptions.reserve(record.optionCount);
+    for (uint32_t k = 0; k < record.optionCount; k++)
+    {
+        auto option = read<OptionRecord>(options, record.firstOption + k);
+        attrOptions.emplace_back(
+            static_cast<AttributeStore::BoundType>(option.boundType),
+            value(option.value), std::string(string(option.valueName)));
+    }
+
+    return {static_cast<AttributeType>(record.type), record.readOnly != 0,
+            std::string(string(record.displayName)),
+            std::string(string(record.description)),
+            std::string(string(record.menuPath)), value(record.currentValue),
+            value(record.defaultValue), std::move(attrOptions)};
+}
+
+BiosImage::PendingAttributes
+    BiosImage::pendingAttributes(std::string_view after, size_t limit) const
+{
+    PendingAttributes pendingAttrs;
+    auto first = sliceStart(pending, sizeof(PendingRecord), after);
+    auto last = first + std::min(limit, pending.count - first);
+    for (size_t i = first; i < last; i++)
+    {
+        auto record = read<PendingRecord>(pending, i);
+        pendingAttrs.emplace_hint(
+            pendingAttrs.end(), string(record.name),
+            PendingAttribute(static_cast<AttributeType>(record.type),
+                             value(record.value)));
+    }
+
+    return pendingAttrs;
+}
+
+size_t BiosImage::size() const
+{
+    return attributes.count;
+}
+
+size_t BiosImage::pendingCount() const
+{
+    return pending.count;
+}
+
+} // namespace bios_config
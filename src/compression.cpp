@@ -0,0 +1,196 @@
+#include "compression.hpp"
+
+#include <zstd.h>
+
+#include <phosphor-logging/lg2.hpp>
+
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+
+namespace bios_config::compression
+{
+
+namespace
+{
+
+struct Header
+{
+    std::array<char, 8> magic;
+    uint32_t version;
+    uint32_t codec;
+    uint32_t dictionaryId;
+    uint32_t reserved;
+    uint64_t compressedSize;
+    uint64_t payloadSize;
+};
+
+constexpr uint32_t version = 1;
+
+/** @brief Upper bound of a payload, a corrupted size must not make us
+ *         allocate the whole memory of the BMC.
+ */
+constexpr uint64_t maxPayloadSize = 256 * 1024 * 1024;
+
+/** @brief The dictionary configured at build time, loaded on first use.
+ */
+struct Dictionary
+{
+    std::string data;
+    uint32_t id = 0;
+
+    Dictionary()
+    {
+        std::string_view path = PERSIST_COMPRESSION_DICTIONARY;
+        if (path.empty())
+        {
+            return;
+        }
+
+        std::ifstream is(std::string(path), std::ios::in | std::ios::binary);
+        std::ostringstream os;
+        os << is.rdbuf();
+        if (!is.is_open() || os.fail())
+        {
+            lg2::error("Failed to read compression dictionary {FILE}", "FILE",
+                       path);
+            return;
+        }
+
+        // Only dictionaries trained by zstd carry the identifier that is
+        // recorded to find the dictionary a container needs
+        id = ZSTD_getDictID_fromDict(os.view().data(), os.view().size());
+        if (id == 0)
+        {
+            lg2::error("Ignoring compression dictionary {FILE} without an "
+                       "identifier",
+                       "FILE", path);
+            return;
+        }
+        data = std::move(os).str();
+    }
+};
+
+const Dictionary& dictionary()
+{
+    static const Dictionary dict;
+    return dict;
+}
+
+} // namespace
+
+std::string compress(std::string_view payload, int level)
+{
+    if (level <= 0 || payload.size() < minPayloadSize)
+    {
+        return std::string(payload);
+    }
+
+    std::unique_ptr<ZSTD_CCtx, decltype(&ZSTD_freeCCtx)> context(
+        ZSTD_createCCtx(), ZSTD_freeCCtx);
+    if (!context)
+    {
+        throw std::bad_alloc();
+    }
+
+    std::string container(sizeof(Header) + ZSTD_compressBound(payload.size()),
+                          '\0');
+    const auto& dict = dictionary();
+    size_t size = ZSTD_compress_usingDict(
+        context.get(), container.data() + sizeof(Header),
+        container.size() - sizeof(Header), payload.data(), payload.size(),
+        dict.data.data(), dict.data.size(), level);
+    if (ZSTD_isError(size))
+    {
+        throw std::runtime_error(std::string("Failed to compress: ") +
+                                 ZSTD_getErrorName(size));
+    }
+
+    // Not worth a container
+    if (size >= payload.size())
+    {
+        return std::string(payload);
+    }
+
+    Header header{};
+    header.magic = magic;
+    header.version = version;
+    header.codec = static_cast<uint32_t>(Codec::zstd);
+    header.dictionaryId = dict.id;
+    header.compressedSize = size;
+    header.payloadSize = payload.size();
+    std::memcpy(container.data(), &header, sizeof(header));
+    container.resize(sizeof(Header) + size);
+    return container;
+}
+
+bool isCompressed(std::span<const char> data)
+{
+    return data.size() >= sizeof(Header) &&
+           std::memcmp(data.data(), magic.data(), magic.size()) == 0;
+}
+
+std::string decompress(std::span<const char> data)
+{
+    if (!isCompressed(data))
+    {
+        throw std::runtime_error("Not a compressed container");
+    }
+
+    Header header{};
+    std::memcpy(&header, data.data(), sizeof(header));
+    if (header.version != version ||
+        header.codec != static_cast<uint32_t>(Codec::zstd))
+    {
+        throw std::runtime_error("Unsupported compressed container");
+    }
+    if (header.compressedSize > data.size() - sizeof(Header) ||
+        header.payloadSize > maxPayloadSize)
+    {
+        throw std::runtime_error("Compressed container out of bounds");
+    }
+
+    auto frame = data.subspan(sizeof(Header), header.compressedSize);
+    auto trailer = data.subspan(sizeof(Header) + header.compressedSize);
+
+    const auto& dict = dictionary();
+    std::string_view dictData;
+    if (header.dictionaryId != 0)
+    {
+        if (header.dictionaryId != dict.id)
+        {
+            throw std::runtime_error("Compressed with dictionary " +
+                                     std::to_string(header.dictionaryId) +
+                                     " which is not available");
+        }
+        dictData = dict.data;
+    }
+
+    std::unique_ptr<ZSTD_DCtx, decltype(&ZSTD_freeDCtx)> context(
+        ZSTD_createDCtx(), ZSTD_freeDCtx);
+    if (!context)
+    {
+        throw std::bad_alloc();
+    }
+
+    std::string payload(header.payloadSize + trailer.size(), '\0');
+    size_t size = ZSTD_decompress_usingDict(
+        context.get(), payload.data(), header.payloadSize, frame.data(),
+        frame.size(), dictData.data(), dictData.size());
+    if (ZSTD_isError(size) || size != header.payloadSize)
+    {
+        throw std::runtime_error("Failed to decompress the container");
+    }
+
+    std::memcpy(payload.data() + size, trailer.data(), trailer.size());
+    return payload;
+}
+
+uint32_t dictionaryId()
+{
+    return dictionary().id;
+}
+
+} // namespace bios_config::compression
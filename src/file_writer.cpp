@@ -0,0 +1,314 @@
+#include "file_writer.hpp"
+
+#include <fcntl.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <boost/asio/buffer.hpp>
+#include <phosphor-logging/lg2.hpp>
+
+#include <cerrno>
+#include <iterator>
+
+namespace bios_config
+{
+
+namespace fs = std::filesystem;
+
+FileWriter::FileWriter(boost::asio::io_context& io, Metrics& metrics) :
+    metrics(metrics), event(io, ::eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK)),
+    eventFd(event.native_handle())
+{
+    waitCompletions();
+    thread = std::thread([this]() { run(); });
+}
+
+FileWriter::~FileWriter()
+{
+    {
+        std::lock_guard lock(mutex);
+        stopping = true;
+    }
+    wakeWriter.notify_one();
+    thread.join();
+}
+
+void FileWriter::replace(const fs::path& path, std::string data, Done done)
+{
+    submit({path, Mode::replace, std::move(data), {}, false}, std::move(done));
+}
+
+void FileWriter::append(const fs::path& path, std::string data, Done done)
+{
+    submit({path, Mode::append, std::move(data), {}, false}, std::move(done));
+}
+
+void FileWriter::submit(Request request, Done done)
+{
+    {
+        std::lock_guard lock(mutex);
+
+        // The thread has not picked up the earlier requests for the file
+        // yet, the new content makes writing them pointless.
+        if (request.mode == Mode::replace)
+        {
+            std::erase_if(queued, [&request](Request& earlier) {
+                if (earlier.path != request.path)
+                {
+                    return false;
+                }
+                std::ranges::move(earlier.done,
+                                  std::back_inserter(request.done));
+                return true;
+            });
+        }
+
+        if (done)
+        {
+            request.done.emplace_back(std::move(done));
+        }
+        queued.emplace_back(std::move(request));
+    }
+    wakeWriter.notify_one();
+}
+
+void FileWriter::drain()
+{
+    {
+        std::unique_lock lock(mutex);
+        idle.wait(lock, [this]() { return queued.empty() && !writing; });
+    }
+    runCompletions();
+}
+
+void FileWriter::run()
+{
+    // The buffer written out while the io context fills the other one
+    std::vector<Request> batch;
+
+    std::unique_lock lock(mutex);
+    while (true)
+    {
+        wakeWriter.wait(lock,
+                        [this]() { return stopping || !queued.empty(); });
+        if (queued.empty())
+        {
+            return;
+        }
+
+        batch.swap(queued);
+        writing = true;
+        lock.unlock();
+
+        for (auto& request : batch)
+        {
+            request.ok = write(request);
+            request.data = {};
+        }
+
+        lock.lock();
+        std::ranges::move(batch, std::back_inserter(completed));
+        batch.clear();
+        writing = false;
+        idle.notify_all();
+
+        uint64_t one = 1;
+        if (::write(eventFd, &one, sizeof(one)) < 0)
+        {
+            lg2::error("Failed to signal completed writes: {ERRNO}", "ERRNO",
+                       errno);
+        }
+    }
+}
+
+bool FileWriter::write(const Request& request)
+{
+    if (request.mode == Mode::append && failed.contains(request.path))
+    {
+        lg2::error("Not appending to {FILE} after a failed write", "FILE",
+                   request.path);
+        return false;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    bool ok = (request.mode == Mode::replace)
+                  ? replaceFile(request.path, request.data)
+                  : appendFile(request.path, request.data);
+    metrics.recordWrite(std::chrono::steady_clock::now() - start);
+
+    if (!ok)
+    {
+        failed.insert(request.path);
+        return false;
+    }
+    if (request.mode == Mode::replace)
+    {
+        failed.erase(request.path);
+    }
+    metrics.addPersistedBytes(request.data.size());
+    return true;
+}
+
+void FileWriter::waitCompletions()
+{
+    event.async_read_some(
+        boost::asio::buffer(&eventCount, sizeof(eventCount)),
+        [this](const boost::system::error_code& ec, size_t) {
+            if (ec == boost::asio::error::operation_aborted)
+            {
+                return;
+            }
+            runCompletions();
+            waitCompletions();
+        });
+}
+
+void FileWriter::runCompletions()
+{
+    std::vector<Request> batch;
+    {
+        std::lock_guard lock(mutex);
+        batch.swap(completed);
+    }
+
+    for (const auto& request : batch)
+    {
+        for (const auto& done : request.done)
+        {
+            try
+            {
+                done(request.ok);
+            }
+            catch (const std::exception& e)
+            {
+                lg2::error("Failed to complete a write of {FILE}: {ERROR}",
+                           "FILE", request.path, "ERROR", e);
+            }
+        }
+    }
+}
+
+/** @brief Write the whole buffer to a file descriptor.
+ *
+ *  @return true if every byte was written.
+ */
+static bool writeAll(int fd, const std::string& data)
+{
+    const char* next = data.data();
+    size_t left = data.size();
+    while (left != 0)
+    {
+        auto written = ::write(fd, next, left);
+        if (written < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (written <= 0)
+        {
+            return false;
+        }
+        next += written;
+        left -= static_cast<size_t>(written);
+    }
+    return true;
+}
+
+/** @brief Sync a directory so that a rename within it is durable.
+ */
+static void syncDirectory(const fs::path& dir)
+{
+    auto path = dir.empty() ? fs::path(".") : dir;
+    int fd = ::open(path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0 || ::fsync(fd) != 0)
+    {
+        lg2::error("Failed to sync directory {DIR}: {ERRNO}", "DIR", path,
+                   "ERRNO", errno);
+    }
+    if (fd >= 0)
+    {
+        ::close(fd);
+    }
+}
+
+bool FileWriter::replaceFile(const fs::path& path, const std::string& data)
+{
+    auto tmpPath = path;
+    tmpPath += ".tmp";
+
+    int fd = ::open(tmpPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+                    0644);
+    if (fd < 0)
+    {
+        lg2::error("Failed to open file for writing: {FILE}: {ERRNO}", "FILE",
+                   tmpPath, "ERRNO", errno);
+        return false;
+    }
+
+    bool ok = writeAll(fd, data) && ::fsync(fd) == 0;
+    ok = (::close(fd) == 0) && ok;
+    if (!ok)
+    {
+        lg2::error("Failed to write file: {FILE}: {ERRNO}", "FILE", tmpPath,
+                   "ERRNO", errno);
+        ::unlink(tmpPath.c_str());
+        return false;
+    }
+
+    std::error_code ec;
+    fs::rename(tmpPath, path, ec);
+    if (ec)
+    {
+        lg2::error("Failed to replace file: {FILE}: {ERROR}", "FILE", path,
+                   "ERROR", ec.message());
+        return false;
+    }
+
+    syncDirectory(path.parent_path());
+    return true;
+}
+
+bool FileWriter::appendFile(const fs::path& path, const std::string& data)
+{
+    int fd = ::open(path.c_str(), O_WRONLY | O_APPEND | O_CLOEXEC);
+    if (fd < 0)
+    {
+        // Appending only makes sense to a file that was written before
+        if (errno != ENOENT)
+        {
+            lg2::error("Failed to open file for appending: {FILE}: {ERRNO}",
+                       "FILE", path, "ERRNO", errno);
+        }
+        return false;
+    }
+
+    bool ok = writeAll(fd, data) && ::fdatasync(fd) == 0;
+    ok = (::close(fd) == 0) && ok;
+    if (!ok)
+    {
+        lg2::error("Failed to append to file: {FILE}: {ERRNO}", "FILE", path,
+                   "ERRNO", errno);
+    }
+    return ok;
+}
+
+bool FileWriter::setAside(const fs::path& path)
+{
+    auto corruptPath = path;
+    corruptPath += ".corrupt";
+
+    std::error_code ec;
+    fs::rename(path, corruptPath, ec);
+    if (ec)
+    {
+        lg2::error("Failed to set aside file: {FILE}: {ERROR}", "FILE", path,
+                   "ERROR", ec.message());
+        return false;
+    }
+
+    lg2::error("Set aside {FILE} as {CORRUPT}", "FILE", path, "CORRUPT",
+               corruptPath);
+    syncDirectory(path.parent_path());
+    return true;
+}
+
+} // namespace bios_config
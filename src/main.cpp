@@ -16,8 +16,11 @@
 
 #include "config.hpp"
 #include "manager.hpp"
+#include "metrics.hpp"
 #include "password.hpp"
+#include "persist_scheduler.hpp"
 #include "secureboot.hpp"
+#include "startup_timer.hpp"
 
 #include <boost/asio.hpp>
 #include <phosphor-logging/elog-errors.hpp>
@@ -29,6 +32,9 @@ PHOSPHOR_LOG2_USING;
 
 int main(int argc, char** argv)
 {
+    using Phase = bios_config::StartupTimer::Phase;
+    bios_config::StartupTimer startupTimer;
+
     std::string persistPath = BIOS_PERSIST_PATH;
     if (argc >= 2)
     {
@@ -40,8 +46,24 @@ int main(int argc, char** argv)
     auto systemBus = std::make_shared<sdbusplus::asio::connection>(io);
 
     systemBus->request_name(bios_config::service);
+    startupTimer.end(Phase::requestName);
+
     sdbusplus::asio::object_server objectServer(systemBus);
 
+    /**
+     * Handler latencies, persistence and table size metrics under
+     * /xyz/openbmc_project/bios_config/metrics
+     */
+    bios_config::Metrics metrics(objectServer);
+
+    /**
+     * Changes to the persisted state are coalesced and written once per
+     * commit window, or once enough changes are waiting.
+     */
+    bios_config::PersistScheduler persistScheduler(
+        io, objectServer, std::chrono::milliseconds(PERSIST_WINDOW_MS),
+        PERSIST_MAX_PENDING, metrics);
+
     /**
      * Manager class is responsible for handling methods and signals under
      * the following object path and interface.
@@ -49,7 +71,9 @@ int main(int argc, char** argv)
      * Object path : /xyz/openbmc_project/bios_config/manager
      * Interface : xyz.openbmc_project.BIOSConfig.Manager
      */
-    bios_config::Manager manager(objectServer, systemBus, persistPath);
+    bios_config::Manager manager(objectServer, systemBus, persistPath,
+                                 persistScheduler, metrics);
+    startupTimer.end(Phase::manager);
 
     /**
      * Password class is responsible for handling methods and signals under
@@ -58,7 +82,9 @@ int main(int argc, char** argv)
      * Object path : /xyz/openbmc_project/bios_config/password
      * Interface : xyz.openbmc_project.BIOSConfig.Password
      */
-    bios_config_pwd::Password password(objectServer, systemBus, persistPath);
+    bios_config_pwd::Password password(objectServer, systemBus, persistPath,
+                                       persistScheduler, metrics);
+    startupTimer.end(Phase::password);
 
 #ifdef ENABLE_BIOS_SECUREBOOT
     /**
@@ -68,9 +94,26 @@ int main(int argc, char** argv)
      * Object path : /xyz/openbmc_project/bios_config/secure_boot
      * Interface : xyz.openbmc_project.BIOSConfig.SecureBoot
      */
-    bios_config::SecureBoot secureboot(objectServer, systemBus, persistPath);
+    bios_config::SecureBoot secureboot(objectServer, systemBus, persistPath,
+                                       persistScheduler, metrics);
+    startupTimer.end(Phase::secureBoot);
 #endif
 
+    // Write out everything that is still queued before exiting
+    boost::asio::signal_set signals(io, SIGINT, SIGTERM);
+    signals.async_wait(
+        [&io, &persistScheduler](const boost::system::error_code& ec, int) {
+            if (!ec)
+            {
+                persistScheduler.sync();
+            }
+            io.stop();
+        });
+
+    // All the state is loaded, dependent services can start
+    startupTimer.ready(objectServer);
+
     io.run();
+    persistScheduler.sync();
     return 0;
 }
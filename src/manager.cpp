@@ -26,6 +26,12 @@
 #include <sdbusplus/asio/connection.hpp>
 #include <sdbusplus/asio/object_server.hpp>
 
+#include <algorithm>
+#include <charconv>
+#include <deque>
+#include <fstream>
+#include <sstream>
+
 namespace bios_config
 {
 
@@ -34,123 +40,651 @@ using namespace sdbusplus::xyz::openbmc_project::BIOSConfig::Common::Error;
 
 void Manager::setAttribute(AttributeName attribute, AttributeValue value)
 {
-    auto pendingAttrs = Base::pendingAttributes();
-    auto iter = pendingAttrs.find(attribute);
+    auto timer = metrics.time(Metrics::Handler::setAttribute);
+    materialize();
+    Manager::PendingAttribute attributeValue;
 
-    if (iter != pendingAttrs.end())
+    // Keep the type of an existing pending value, otherwise derive it from
+    // the variant. Only the changed attribute is passed on, the other pending
+    // attributes are left as they are.
+    const auto* pending = findPending(attribute);
+    if (pending != nullptr)
+    {
+        std::get<0>(attributeValue) = std::get<0>(*pending);
+    }
+    else if (std::get_if<int64_t>(&value))
     {
-        std::get<1>(iter->second) = value;
+        std::get<0>(attributeValue) = AttributeType::Integer;
     }
     else
     {
-        Manager::PendingAttribute attributeValue;
+        std::get<0>(attributeValue) = AttributeType::String;
+    }
 
-        if (std::get_if<int64_t>(&value))
-        {
-            std::get<0>(attributeValue) = AttributeType::Integer;
-        }
-        else
-        {
-            std::get<0>(attributeValue) = AttributeType::String;
-        }
+    std::get<1>(attributeValue) = std::move(value);
+
+    updatePending({{std::move(attribute), std::move(attributeValue)}});
+}
+
+/** @brief Convert the fields of an attribute to the GetAttribute reply.
+ */
+static Manager::AttributeDetails details(AttributeSnapshot::Lookup found)
+{
+    Manager::AttributeDetails value;
 
-        std::get<1>(attributeValue) = value;
-        pendingAttrs.emplace(attribute, attributeValue);
+    std::get<0>(value) = found.type;
+    std::get<1>(value) = std::move(found.currentValue);
+
+    if (found.pending)
+    {
+        std::get<2>(value) = std::get<1>(std::move(*found.pending));
+    }
+    else if (std::get_if<std::string>(&std::get<1>(value)))
+    {
+        std::get<2>(value) = std::string();
     }
 
-    pendingAttributes(pendingAttrs);
+    return value;
 }
 
 Manager::AttributeDetails Manager::getAttribute(AttributeName attribute)
 {
-    Manager::AttributeDetails value;
+    auto timer = metrics.time(Metrics::Handler::getAttribute);
 
-    auto table = Base::baseBIOSTable();
-    auto iter = table.find(attribute);
+    // Served from the latest snapshot, which never changes under the reader
+    const auto& snapshot = snapshots.latest();
+    auto found = snapshot.find(attribute);
+    if (!found || snapshot.hidden(attribute))
+    {
+        throw AttributeNotFound();
+    }
+
+    return details(std::move(*found));
+}
+
+/** @brief Read several attributes from one snapshot, see getAttributes.
+ */
+static Manager::AttributeDetailsReport
+    readAttributes(const AttributeSnapshot& snapshot,
+                   std::vector<Manager::AttributeName> names)
+{
+    Manager::AttributeDetailsReport report;
+    auto& [found, missing] = report;
 
-    if (iter != table.end())
+    if (names.empty())
     {
-        std::get<0>(value) =
-            std::get<static_cast<uint8_t>(Index::attributeType)>(iter->second);
-        std::get<1>(value) =
-            std::get<static_cast<uint8_t>(Index::currentValue)>(iter->second);
+        snapshot.forEach(
+            [&found](std::string_view name, AttributeSnapshot::Lookup lookup) {
+                found.emplace_hint(found.end(), name,
+                                   details(std::move(lookup)));
+            });
+        return report;
+    }
 
-        auto pending = Base::pendingAttributes();
-        auto pendingIter = pending.find(attribute);
-        if (pendingIter != pending.end())
+    for (auto& name : names)
+    {
+        auto lookup = snapshot.find(name);
+        if (!lookup || snapshot.hidden(name))
         {
-            std::get<2>(value) = std::get<1>(pendingIter->second);
+            missing.emplace_back(std::move(name));
+            continue;
         }
-        else if (std::get_if<std::string>(&std::get<1>(value)))
+        found.insert_or_assign(std::move(name), details(std::move(*lookup)));
+    }
+    return report;
+}
+
+/** @brief List a submenu from a snapshot of materialized attributes, see
+ *         getMenu.
+ */
+static Manager::MenuReport readMenu(const AttributeSnapshot& snapshot,
+                                    const std::string& path)
+{
+    const auto& store = *snapshot.table;
+
+    const auto* node = store.menus().find(path);
+    if (node == nullptr)
+    {
+        lg2::error("No BIOS menu at {PATH}", "PATH", path);
+        throw InvalidArgument();
+    }
+
+    Manager::MenuReport report;
+    auto& [submenus, found] = report;
+    submenus.reserve(node->children.size());
+    for (const auto& [name, child] : node->children)
+    {
+        submenus.emplace_back(name);
+    }
+
+    // The attributes of a submenu were added in name order
+    for (auto index : node->attributes)
+    {
+        const auto& name = store.all()[index].name;
+        auto lookup = snapshot.find(name);
+        if (lookup && !snapshot.hidden(name))
         {
-            std::get<2>(value) = std::string();
+            found.emplace_hint(found.end(), name, details(std::move(*lookup)));
         }
     }
-    else
+    return report;
+}
+
+/** @brief Check the size of a page asked for by a client.
+ */
+static void checkPageSize(uint32_t pageSize)
+{
+    if (pageSize == 0 || pageSize > maxPageSize)
     {
-        throw AttributeNotFound();
+        lg2::error("Invalid page size {SIZE}", "SIZE", pageSize);
+        throw InvalidArgument();
     }
+}
 
-    return value;
+/** @brief Name of the last attribute of the previous page, read from the
+ *         "<generation>:<name>" cursor returned with it.
+ *
+ *  @param[in] cursor - cursor, empty for the first page
+ *  @param[in] generation - generation the cursor must have been returned
+ *                          for
+ *
+ *  @return The name, empty for the first page. On error, throw exception
+ */
+static std::string_view cursorName(std::string_view cursor,
+                                   uint64_t generation)
+{
+    if (cursor.empty())
+    {
+        return {};
+    }
+
+    uint64_t cursorGeneration = 0;
+    auto separator = cursor.find(':');
+    auto end = cursor.data() + std::min(separator, cursor.size());
+    auto [ptr, ec] = std::from_chars(cursor.data(), end, cursorGeneration);
+    if (separator == std::string_view::npos || separator + 1 == cursor.size() ||
+        ec != std::errc() || ptr != end)
+    {
+        lg2::error("Malformed page cursor {CURSOR}", "CURSOR", cursor);
+        throw InvalidArgument();
+    }
+    if (cursorGeneration != generation)
+    {
+        lg2::error("Stale page cursor {CURSOR}, the generation is now {GEN}",
+                   "CURSOR", cursor, "GEN", generation);
+        throw InvalidArgument();
+    }
+    return cursor.substr(separator + 1);
 }
 
-Manager::BaseTable Manager::baseBIOSTable(BaseTable value)
+/** @brief Finish a page read with one attribute more than asked for, which
+ *         tells whether another page follows.
+ *
+ *  @return The cursor of the next page, empty after the last page.
+ */
+template <typename Map>
+static std::string finishPage(Map& page, size_t pageSize, uint64_t generation)
 {
-    pendingAttributes({});
-    auto baseTable = Base::baseBIOSTable(value, false);
-    serialize(*this, biosFile);
-    Base::resetBIOSSettings(Base::ResetFlag::NoAction);
-    return baseTable;
+    if (page.size() <= pageSize)
+    {
+        return {};
+    }
+
+    page.erase(std::prev(page.end()));
+    return std::to_string(generation) + ':' + page.rbegin()->first;
+}
+
+/** @brief Read a page of the BaseBIOSTable, see getBaseTablePage.
+ */
+static Manager::TablePage readTablePage(const AttributeSnapshot& snapshot,
+                                        const std::string& cursor,
+                                        uint32_t pageSize)
+{
+    checkPageSize(pageSize);
+
+    auto generation = snapshot.tableGeneration;
+    auto page = snapshot.tableSlice(cursorName(cursor, generation),
+                                    pageSize + size_t{1});
+    auto next = finishPage(page, pageSize, generation);
+    return {std::move(page), std::move(next)};
 }
 
-bool Manager::validateEnumOption(
-    const std::string& attrValue,
-    const std::vector<std::tuple<BoundType, std::variant<int64_t, std::string>,
-                                 std::string>>& options)
+/** @brief Read a page of the PendingAttributes, see getPendingPage.
+ */
+static Manager::PendingPage readPendingPage(const AttributeSnapshot& snapshot,
+                                            const std::string& cursor,
+                                            uint32_t pageSize)
 {
-    for (const auto& enumOptions : options)
+    checkPageSize(pageSize);
+
+    // Any change of the pending values publishes a new generation
+    auto generation = snapshot.generation;
+    auto page = snapshot.pendingSlice(cursorName(cursor, generation),
+                                      pageSize + size_t{1});
+    auto next = finishPage(page, pageSize, generation);
+    return {std::move(page), std::move(next)};
+}
+
+template <typename Read>
+auto Manager::onReader(boost::asio::yield_context yield, Read read)
+{
+    using Result = std::invoke_result_t<Read&, const AttributeSnapshot&>;
+    auto snapshot = snapshots.current();
+
+    // Only this thread submits reads, a pool below the limit accepts one
+    if (readers.inFlight() >= maxQueuedReads)
+    {
+        return read(*snapshot);
+    }
+
+    struct Outcome
+    {
+        std::optional<Result> value;
+        std::exception_ptr error;
+    };
+    auto outcome = std::make_shared<Outcome>();
+    boost::system::error_code ec;
+    readers.run(
+        [snapshot = std::move(snapshot), outcome,
+         read = std::move(read)]() mutable {
+            try
+            {
+                outcome->value.emplace(read(*snapshot));
+            }
+            catch (...)
+            {
+                outcome->error = std::current_exception();
+            }
+        },
+        yield[ec]);
+    if (ec)
     {
-        if ((BoundType::OneOf == std::get<0>(enumOptions)) &&
-            (attrValue == std::get<std::string>(std::get<1>(enumOptions))))
+        throw Unavailable();
+    }
+    if (outcome->error)
+    {
+        std::rethrow_exception(outcome->error);
+    }
+    return std::move(*outcome->value);
+}
+
+Manager::AttributeDetailsReport
+    Manager::getAttributes(std::vector<AttributeName> names)
+{
+    auto timer = metrics.time(Metrics::Handler::getAttributes);
+
+    // Every attribute is read from the same snapshot
+    return readAttributes(snapshots.latest(), std::move(names));
+}
+
+Manager::AttributeDetailsReport
+    Manager::getAttributes(boost::asio::yield_context yield,
+                           std::vector<AttributeName> names)
+{
+    auto timer = metrics.time(Metrics::Handler::getAttributes);
+    return onReader(std::move(yield),
+                    [names = std::move(names)](
+                        const AttributeSnapshot& snapshot) mutable {
+                        return readAttributes(snapshot, std::move(names));
+                    });
+}
+
+Manager::MenuReport Manager::getMenu(std::string path)
+{
+    auto timer = metrics.time(Metrics::Handler::getMenu);
+
+    // The menu index is built with the attribute store
+    materialize();
+    return readMenu(snapshots.latest(), path);
+}
+
+Manager::MenuReport Manager::getMenu(boost::asio::yield_context yield,
+                                     std::string path)
+{
+    auto timer = metrics.time(Metrics::Handler::getMenu);
+    materialize();
+    return onReader(std::move(yield), [path = std::move(path)](
+                                          const AttributeSnapshot& snapshot) {
+        return readMenu(snapshot, path);
+    });
+}
+
+Manager::TablePage Manager::getBaseTablePage(std::string cursor,
+                                             uint32_t pageSize)
+{
+    auto timer = metrics.time(Metrics::Handler::getBaseTablePage);
+    return readTablePage(snapshots.latest(), cursor, pageSize);
+}
+
+Manager::TablePage Manager::getBaseTablePage(boost::asio::yield_context yield,
+                                             std::string cursor,
+                                             uint32_t pageSize)
+{
+    auto timer = metrics.time(Metrics::Handler::getBaseTablePage);
+    return onReader(std::move(yield),
+                    [cursor = std::move(cursor),
+                     pageSize](const AttributeSnapshot& snapshot) {
+                        return readTablePage(snapshot, cursor, pageSize);
+                    });
+}
+
+Manager::PendingPage Manager::getPendingPage(std::string cursor,
+                                             uint32_t pageSize)
+{
+    auto timer = metrics.time(Metrics::Handler::getPendingPage);
+    return readPendingPage(snapshots.latest(), cursor, pageSize);
+}
+
+Manager::PendingPage Manager::getPendingPage(boost::asio::yield_context yield,
+                                             std::string cursor,
+                                             uint32_t pageSize)
+{
+    auto timer = metrics.time(Metrics::Handler::getPendingPage);
+    return onReader(std::move(yield),
+                    [cursor = std::move(cursor),
+                     pageSize](const AttributeSnapshot& snapshot) {
+                        return readPendingPage(snapshot, cursor, pageSize);
+                    });
+}
+
+Manager::BaseTable Manager::baseBIOSTable() const
+{
+    if (image)
+    {
+        // The property is always read whole, decode the image only once
+        if (!imageTable)
         {
-            return true;
+            imageTable = image->baseTable();
         }
+        return *imageTable;
     }
 
-    lg2::error("No valid attribute");
-    return false;
+    // The store is the only copy of the table. The generated class holds
+    // one only while a persisted file is loaded, before the store is filled.
+    if (attributes->size() == 0)
+    {
+        return Base::baseBIOSTable();
+    }
+    return attributes->baseTable();
+}
+
+Manager::PendingAttributes Manager::pendingAttributes() const
+{
+    if (image)
+    {
+        return image->pendingAttributes();
+    }
+
+    // The latest snapshot holds the only copy. The generated class holds one
+    // only while a persisted file is loaded, before the first snapshot.
+    const auto& pending = snapshots.latest().pending;
+    if (!pending)
+    {
+        return Base::pendingAttributes();
+    }
+    return *pending;
 }
 
-bool Manager::validateStringOption(
-    const std::string& attrValue,
-    const std::vector<std::tuple<BoundType, std::variant<int64_t, std::string>,
-                                 std::string>>& options)
+const Manager::PendingAttribute*
+    Manager::findPending(const std::string& name) const
 {
-    size_t minStringLength = 0;
-    size_t maxStringLength = 0;
-    for (const auto& stringOptions : options)
+    const auto& pending = snapshots.latest().pending;
+    if (!pending || pending->empty())
     {
-        if (BoundType::MinStringLength == std::get<0>(stringOptions))
+        return nullptr;
+    }
+
+    auto iter = pending->find(name);
+    return iter != pending->end() ? &iter->second : nullptr;
+}
+
+size_t Manager::pendingCount() const
+{
+    const auto& pending = snapshots.latest().pending;
+    return pending ? pending->size() : 0;
+}
+
+std::shared_ptr<Manager::PendingAttributes>
+    Manager::knownPending(PendingAttributes loaded) const
+{
+    auto pending = std::make_shared<PendingAttributes>(std::move(loaded));
+    std::erase_if(*pending, [this](const auto& item) {
+        if (attributes->find(item.first) != nullptr)
         {
-            minStringLength = std::get<int64_t>(std::get<1>(stringOptions));
+            return false;
         }
-        else if (BoundType::MaxStringLength == std::get<0>(stringOptions))
+        lg2::error("Pending attribute {NAME} is not in the BaseBIOSTable",
+                   "NAME", item.first);
+        return true;
+    });
+    return pending;
+}
+
+void Manager::signalPending()
+{
+    // The generated class only signals a value that differs from the one it
+    // holds, and its getter reads the latest snapshot. It holds a placeholder
+    // just long enough to signal, rather than another copy of the values.
+    Base::pendingAttributes({{std::string(), PendingAttribute()}}, true);
+    Base::pendingAttributes({}, false);
+}
+
+void Manager::signalBaseTable()
+{
+    // As for signalPending: an empty table would not differ from the one
+    // the generated class holds
+    Base::baseBIOSTable({{std::string(), BaseTable::mapped_type()}}, true);
+    Base::baseBIOSTable({}, false);
+}
+
+void Manager::useImage(std::unique_ptr<BiosImage> mapped)
+{
+    image = std::move(mapped);
+    imageTable.reset();
+}
+
+void Manager::materialize()
+{
+    if (!image)
+    {
+        return;
+    }
+
+    auto mapped = std::move(image);
+    imageTable.reset();
+
+    auto store = std::make_shared<AttributeStore>();
+    store->assign(mapped->baseTable());
+    attributes = std::move(store);
+    validatedPending.assign(attributes->size(), false);
+    publish(knownPending(mapped->pendingAttributes()));
+    evaluateDependencies();
+    lg2::info("Loaded {COUNT} BIOS attributes from the mapped image", "COUNT",
+              attributes->size());
+}
+
+Manager::BaseTable Manager::baseBIOSTable(BaseTable value)
+{
+    auto timer = metrics.time(Metrics::Handler::baseBIOSTable);
+    materialize();
+    auto diff = attributes->diff(value);
+    lg2::info(
+        "BaseBIOSTable update: {ADDED} added, {REMOVED} removed, {CHANGED} changed",
+        "ADDED", diff.added.size(), "REMOVED", diff.removed.size(), "CHANGED",
+        diff.changed.size());
+
+    Base::resetBIOSSettings(Base::ResetFlag::NoAction);
+    if (diff.empty())
+    {
+        lastTableDiff = std::move(diff);
+        return value;
+    }
+
+    // Keep the pending values of the attributes whose definition did not
+    // change, unless the host already applied them.
+    auto keptPending = std::make_shared<PendingAttributes>();
+    if (const auto& pending = snapshots.latest().pending)
+    {
+        for (const auto& [name, attr] : *pending)
         {
-            maxStringLength = std::get<int64_t>(std::get<1>(stringOptions));
+            const auto* entry = attributes->find(name);
+            auto iter = value.find(name);
+            if (entry != nullptr && iter != value.end() &&
+                attributes->sameDefinition(*entry, iter->second) &&
+                std::get<1>(attr) !=
+                    std::get<static_cast<uint8_t>(Index::currentValue)>(
+                        iter->second))
+            {
+                keptPending->emplace_hint(keptPending->end(), name, attr);
+            }
         }
-        else
+    }
+
+    // Kept values are a subset, the pending values changed if any is gone
+    const bool pendingChanged = keptPending->size() != pendingCount();
+    if (pendingChanged)
+    {
+        journalClear = true;
+        journalDelta = *keptPending;
+    }
+
+    for (const auto& name : diff.removed)
+    {
+        journalTableUpserts.erase(name);
+        journalTableRemovals.insert(name);
+    }
+    for (const auto* names : {&diff.added, &diff.changed})
+    {
+        for (const auto& name : *names)
         {
-            continue;
+            journalTableRemovals.erase(name);
+            journalTableUpserts.insert_or_assign(name, value.at(name));
         }
     }
 
-    if (attrValue.length() < minStringLength ||
-        attrValue.length() > maxStringLength)
+    auto store = std::make_shared<AttributeStore>();
+    store->assign(value);
+    attributes = std::move(store);
+    validatedPending.assign(attributes->size(), false);
+    publish(std::move(keptPending), true);
+    evaluateDependencies();
+    if (pendingChanged)
+    {
+        signalPending();
+    }
+    signalBaseTable();
+    scheduler.markDirty(writerId);
+    updateSizeMetrics();
+
+    lastTableDiff = std::move(diff);
+    return value;
+}
+
+uint64_t Manager::beginTableUpload(const std::string& owner)
+{
+    auto now = std::chrono::steady_clock::now();
+    if (tableUpload)
+    {
+        // A client that died mid-upload must not block the others forever
+        if (now - tableUpload->lastActivity < tableUploadTimeout)
+        {
+            lg2::error("BaseBIOSTable upload {ID} of {OWNER} is in progress",
+                       "ID", tableUpload->id, "OWNER", tableUpload->owner);
+            throw Unavailable();
+        }
+        lg2::warning("Abandoning idle BaseBIOSTable upload {ID} of {OWNER}",
+                     "ID", tableUpload->id, "OWNER", tableUpload->owner);
+    }
+
+    tableUpload.emplace(++lastUploadId, owner, now, BaseTable{});
+    return lastUploadId;
+}
+
+Manager::TableUpload& Manager::stagedUpload(const std::string& owner,
+                                            uint64_t id)
+{
+    if (!tableUpload || tableUpload->id != id || tableUpload->owner != owner)
+    {
+        lg2::error("No BaseBIOSTable upload with id {ID} in progress for "
+                   "{OWNER}",
+                   "ID", id, "OWNER", owner);
+        throw InvalidArgument();
+    }
+
+    tableUpload->lastActivity = std::chrono::steady_clock::now();
+    return *tableUpload;
+}
+
+void Manager::appendTableChunk(const std::string& owner, uint64_t id,
+                               BaseTable chunk)
+{
+    auto& upload = stagedUpload(owner, id);
+
+    if (chunk.size() > maxTableChunkSize)
+    {
+        lg2::error("BaseBIOSTable chunk of {SIZE} attributes is too large",
+                   "SIZE", chunk.size());
+        throw InvalidArgument();
+    }
+
+    // Attributes replacing staged ones do not grow the table, count only
+    // the new ones
+    size_t added = 0;
+    for (const auto& [name, attr] : chunk)
+    {
+        added += upload.table.contains(name) ? 0 : 1;
+    }
+    if (upload.table.size() + added > maxStagedAttributes)
+    {
+        lg2::error("Staged BaseBIOSTable would exceed {MAX} attributes",
+                   "MAX", maxStagedAttributes);
+        throw InvalidArgument();
+    }
+
+    while (!chunk.empty())
+    {
+        auto node = chunk.extract(chunk.begin());
+        upload.table.insert_or_assign(std::move(node.key()),
+                                      std::move(node.mapped()));
+    }
+}
+
+void Manager::commitTableUpload(const std::string& owner, uint64_t id)
+{
+    auto table = std::move(stagedUpload(owner, id).table);
+    tableUpload.reset();
+
+    baseBIOSTable(std::move(table));
+}
+
+void Manager::abortTableUpload(const std::string& owner, uint64_t id)
+{
+    stagedUpload(owner, id);
+    tableUpload.reset();
+}
+
+bool Manager::validateEnumOption(const std::string& attrValue,
+                                 const AttributeStore::Entry& entry)
+{
+    if (attributes->isOneOf(entry, attrValue))
+    {
+        return true;
+    }
+
+    lg2::error("No valid attribute");
+    return false;
+}
+
+bool Manager::validateStringOption(const std::string& attrValue,
+                                   const AttributeStore::Constraint& constraint)
+{
+    if (attrValue.length() < constraint.minStringLength ||
+        attrValue.length() > constraint.maxStringLength)
     {
         lg2::error(
             "{ATTRVALUE} Length is out of range, bound is invalid, maxStringLength = {MAXLEN}, minStringLength = {MINLEN}",
-            "ATTRVALUE", attrValue, "MAXLEN", maxStringLength, "MINLEN",
-            minStringLength);
+            "ATTRVALUE", attrValue, "MAXLEN", constraint.maxStringLength,
+            "MINLEN", constraint.minStringLength);
         return false;
     }
 
@@ -158,170 +692,566 @@ bool Manager::validateStringOption(
 }
 
 bool Manager::validateIntegerOption(
-    const int64_t& attrValue,
-    const std::vector<std::tuple<BoundType, std::variant<int64_t, std::string>,
-                                 std::string>>& options)
+    const int64_t& attrValue, const AttributeStore::Constraint& constraint)
 {
-    int64_t lowerBound = 0;
-    int64_t upperBound = 0;
-    int64_t scalarIncrement = 0;
+    if ((attrValue < constraint.lowerBound) ||
+        (attrValue > constraint.upperBound))
+    {
+        lg2::error("Integer, bound is invalid");
+        return false;
+    }
 
-    for (const auto& integerOptions : options)
+    if (constraint.scalarIncrement == 0 ||
+        ((std::abs(attrValue - constraint.lowerBound)) %
+         constraint.scalarIncrement) != 0)
     {
-        if (BoundType::LowerBound == std::get<0>(integerOptions))
-        {
-            lowerBound = std::get<int64_t>(std::get<1>(integerOptions));
-        }
-        else if (BoundType::UpperBound == std::get<0>(integerOptions))
+        lg2::error(
+            "((std::abs({ATTR_VALUE} - {LOWER_BOUND})) % {SCALAR_INCREMENT}) != 0",
+            "ATTR_VALUE", attrValue, "LOWER_BOUND", constraint.lowerBound,
+            "SCALAR_INCREMENT", constraint.scalarIncrement);
+        return false;
+    }
+
+    return true;
+}
+
+void Manager::validatePendingAttribute(const std::string& name,
+                                       const PendingAttribute& value)
+{
+    try
+    {
+        checkPendingAttribute(name, value);
+    }
+    catch (const std::exception&)
+    {
+        metrics.countValidationFailure();
+        throw;
+    }
+}
+
+void Manager::checkPendingAttribute(const std::string& name,
+                                    const PendingAttribute& value)
+{
+    const auto* entry = attributes->find(name);
+    // BIOS attribute not found in the BaseBIOSTable
+    if (entry == nullptr)
+    {
+        lg2::error("BIOS attribute not found in the BaseBIOSTable");
+        throw AttributeNotFound();
+    }
+
+    auto attributeType = entry->type;
+    if (attributeType != std::get<0>(value))
+    {
+        lg2::error("attributeType is not same with bios base table");
+        throw InvalidArgument();
+    }
+
+    // Validate enumeration BIOS attributes
+    if (attributeType == AttributeType::Enumeration)
+    {
+        // For enumeration the expected variant types is Enumeration
+        if (std::get<1>(value).index() == 0)
         {
-            upperBound = std::get<int64_t>(std::get<1>(integerOptions));
+            lg2::error("Enumeration property value is not enum");
+            throw InvalidArgument();
         }
-        else if (BoundType::ScalarIncrement == std::get<0>(integerOptions))
+
+        const auto& attrValue = std::get<std::string>(std::get<1>(value));
+
+        if (!validateEnumOption(attrValue, *entry))
         {
-            scalarIncrement = std::get<int64_t>(std::get<1>(integerOptions));
+            throw InvalidArgument();
         }
     }
 
-    if ((attrValue < lowerBound) || (attrValue > upperBound))
+    if (attributeType == AttributeType::String)
     {
-        lg2::error("Integer, bound is invalid");
-        return false;
+        // For enumeration the expected variant types is std::string
+        if (std::get<1>(value).index() == 0)
+        {
+            lg2::error("String property value is not string");
+            throw InvalidArgument();
+        }
+
+        const auto& attrValue = std::get<std::string>(std::get<1>(value));
+
+        if (!validateStringOption(attrValue, entry->constraint))
+        {
+            throw InvalidArgument();
+        }
     }
 
-    if (scalarIncrement == 0 ||
-        ((std::abs(attrValue - lowerBound)) % scalarIncrement) != 0)
+    if (attributeType == AttributeType::Integer)
     {
-        lg2::error(
-            "((std::abs({ATTR_VALUE} - {LOWER_BOUND})) % {SCALAR_INCREMENT}) != 0",
-            "ATTR_VALUE", attrValue, "LOWER_BOUND", lowerBound,
-            "SCALAR_INCREMENT", scalarIncrement);
-        return false;
-    }
+        // For enumeration the expected variant types is Integer
+        if (std::get<1>(value).index() == 1)
+        {
+            lg2::error("Integer property value is not int");
+            throw InvalidArgument();
+        }
 
-    return true;
+        const auto& attrValue = std::get<int64_t>(std::get<1>(value));
+
+        if (!validateIntegerOption(attrValue, entry->constraint))
+        {
+            throw InvalidArgument();
+        }
+    }
 }
 
 Manager::PendingAttributes Manager::pendingAttributes(PendingAttributes value)
 {
+    auto timer = metrics.time(Metrics::Handler::pendingAttributes);
+    updatePending(std::move(value));
+    return pendingAttributes();
+}
+
+void Manager::updatePending(PendingAttributes value)
+{
+    materialize();
+
     // Clear the pending attributes
     if (value.empty())
     {
-        auto pendingAttrs = Base::pendingAttributes({}, false);
-        serialize(*this, biosFile);
-        return pendingAttrs;
+        validatedPending.assign(validatedPending.size(), false);
+        publish(std::make_shared<PendingAttributes>());
+        evaluateDependencies();
+        signalPending();
+        persistPending(value);
+        updateSizeMetrics();
+        return;
     }
 
-    // Validate all the BIOS attributes before setting PendingAttributes
-    BaseTable biosTable = Base::baseBIOSTable();
-    for (const auto& pair : value)
+    // Validate the BIOS attributes before setting PendingAttributes. Values
+    // that are already pending and were validated against the current table
+    // are neither validated again nor persisted again.
+    PendingAttributes delta;
+    for (auto& [name, attr] : value)
     {
-        auto iter = biosTable.find(pair.first);
-        // BIOS attribute not found in the BaseBIOSTable
-        if (iter == biosTable.end())
+        const auto* entry = attributes->find(name);
+        const auto* pending = findPending(name);
+        if (entry != nullptr && validatedPending[attributes->index(*entry)] &&
+            pending != nullptr && *pending == attr)
         {
-            lg2::error("BIOS attribute not found in the BaseBIOSTable");
-            throw AttributeNotFound();
+            continue;
         }
 
-        auto attributeType =
-            std::get<static_cast<uint8_t>(Index::attributeType)>(iter->second);
-        if (attributeType != std::get<0>(pair.second))
+        validatePendingAttribute(name, attr);
+        delta.emplace_hint(delta.end(), name, std::move(attr));
+    }
+
+    if (delta.empty())
+    {
+        return;
+    }
+
+    checkDependencies(delta);
+    applyPending(delta);
+}
+
+void Manager::setAttributes(AttributeValues values)
+{
+    auto timer = metrics.time(Metrics::Handler::setAttributes);
+    materialize();
+    PendingAttributes delta;
+
+    // Validate every new value before any of them is applied
+    for (auto& [name, value] : values)
+    {
+        const auto* entry = attributes->find(name);
+        if (entry == nullptr)
         {
-            lg2::error("attributeType is not same with bios base table");
-            throw InvalidArgument();
+            lg2::error("BIOS attribute {NAME} not found in the BaseBIOSTable",
+                       "NAME", name);
+            throw AttributeNotFound();
         }
 
-        // Validate enumeration BIOS attributes
-        if (attributeType == AttributeType::Enumeration)
-        {
-            // For enumeration the expected variant types is Enumeration
-            if (std::get<1>(pair.second).index() == 0)
-            {
-                lg2::error("Enumeration property value is not enum");
-                throw InvalidArgument();
-            }
+        PendingAttribute attr(entry->type, std::move(value));
+        validatePendingAttribute(name, attr);
+        delta.emplace_hint(delta.end(), name, std::move(attr));
+    }
 
-            const auto& attrValue =
-                std::get<std::string>(std::get<1>(pair.second));
-            const auto& options =
-                std::get<static_cast<uint8_t>(Index::options)>(iter->second);
+    if (!delta.empty())
+    {
+        checkDependencies(delta);
+        applyPending(delta);
+    }
+}
 
-            if (!validateEnumOption(attrValue, options))
-            {
-                throw InvalidArgument();
-            }
+const AttributeStore::Value*
+    Manager::effectiveValue(std::string_view name,
+                            const PendingAttributes& delta) const
+{
+    if (!delta.empty())
+    {
+        auto iter = delta.find(std::string(name));
+        if (iter != delta.end())
+        {
+            return &std::get<1>(iter->second);
         }
+    }
 
-        if (attributeType == AttributeType::String)
-        {
-            // For enumeration the expected variant types is std::string
-            if (std::get<1>(pair.second).index() == 0)
-            {
-                lg2::error("String property value is not string");
-                throw InvalidArgument();
-            }
+    const auto* entry = attributes->find(name);
+    if (entry == nullptr)
+    {
+        return nullptr;
+    }
+    const auto* pending = findPending(entry->name);
+    return pending != nullptr ? &std::get<1>(*pending) : &entry->currentValue;
+}
 
-            const auto& attrValue =
-                std::get<std::string>(std::get<1>(pair.second));
-            const auto& options =
-                std::get<static_cast<uint8_t>(Index::options)>(iter->second);
+void Manager::checkDependencies(const PendingAttributes& delta)
+{
+    if (dependencies.size() == 0)
+    {
+        return;
+    }
 
-            if (!validateStringOption(attrValue, options))
-            {
-                throw InvalidArgument();
-            }
+    std::vector<std::string_view> changed;
+    changed.reserve(delta.size());
+    for (const auto& [name, attr] : delta)
+    {
+        changed.emplace_back(name);
+    }
+
+    auto states = dependencies.evaluate(
+        changed, [this, &delta](std::string_view name) {
+            return effectiveValue(name, delta);
+        });
+    auto stateOf = [this, &states](const std::string& name) {
+        auto iter = states.find(name);
+        return iter != states.end() ? &iter->second : dependencies.state(name);
+    };
+    auto outOfBounds = [](const AttributeDependencies::State& state,
+                          const AttributeStore::Value& value) {
+        const auto* number = std::get_if<int64_t>(&value);
+        return number != nullptr &&
+               ((state.lowerBound && *number < *state.lowerBound) ||
+                (state.upperBound && *number > *state.upperBound));
+    };
+
+    for (const auto& [name, attr] : delta)
+    {
+        const auto* state = stateOf(name);
+        if (state == nullptr)
+        {
+            continue;
         }
 
-        if (attributeType == AttributeType::Integer)
+        if (state->readOnly || state->hidden)
         {
-            // For enumeration the expected variant types is Integer
-            if (std::get<1>(pair.second).index() == 1)
-            {
-                lg2::error("Integer property value is not int");
-                throw InvalidArgument();
-            }
+            lg2::error("BIOS attribute {NAME} is {STATE} by a dependency",
+                       "NAME", name, "STATE",
+                       state->hidden ? "hidden" : "read-only");
+            metrics.countValidationFailure();
+            throw AttributeReadOnly();
+        }
 
-            const auto& attrValue = std::get<int64_t>(std::get<1>(pair.second));
-            const auto& options =
-                std::get<static_cast<uint8_t>(Index::options)>(iter->second);
+        if (outOfBounds(*state, std::get<1>(attr)))
+        {
+            lg2::error("BIOS attribute {NAME} is out of the bounds set by a "
+                       "dependency",
+                       "NAME", name);
+            metrics.countValidationFailure();
+            throw InvalidArgument();
+        }
+    }
 
-            if (!validateIntegerOption(attrValue, options))
-            {
-                throw InvalidArgument();
-            }
+    // A new bound must not leave a value that is already pending outside
+    for (const auto& [name, state] : states)
+    {
+        const auto* pending = findPending(name);
+        if (pending != nullptr && !delta.contains(name) &&
+            outOfBounds(state, std::get<1>(*pending)))
+        {
+            lg2::error("Pending value of {NAME} would be out of the bounds "
+                       "set by a dependency",
+                       "NAME", name);
+            metrics.countValidationFailure();
+            throw InvalidArgument();
         }
     }
 
-    PendingAttributes pendingAttribute = Base::pendingAttributes();
+    const bool ownSnapshot = snapshots.ownsStates(dependencies.shared());
+    dependencies.commit(std::move(states), ownSnapshot);
+}
+
+void Manager::evaluateDependencies()
+{
+    if (image && dependencies.size() != 0)
+    {
+        // Read the sources from the mapped image, which stays mapped; their
+        // values are kept until the evaluation is done
+        std::deque<AttributeStore::Value> values;
+        dependencies.evaluateAll(
+            [this, &values](
+                std::string_view name) -> const AttributeStore::Value* {
+                auto lookup = image->find(name);
+                if (!lookup)
+                {
+                    return nullptr;
+                }
+                return &values.emplace_back(
+                    lookup->pending ? std::get<1>(*lookup->pending)
+                                    : lookup->currentValue);
+            });
+    }
+    else if (dependencies.size() != 0)
+    {
+        const PendingAttributes none;
+        dependencies.evaluateAll([this, &none](std::string_view name) {
+            return effectiveValue(name, none);
+        });
+    }
+
+    // The reads apply the states of the latest snapshot
+    if (snapshots.latest().states != dependencies.shared())
+    {
+        snapshots.publishStates(dependencies.shared());
+    }
+}
+
+void Manager::loadDependencies()
+{
+    std::ifstream is(dependenciesFile, std::ios::in);
+    if (!is.is_open())
+    {
+        return;
+    }
 
-    for (const auto& pair : value)
+    std::ostringstream rules;
+    rules << is.rdbuf();
+    try
+    {
+        dependencies.assign(AttributeDependencies::parse(rules.view()));
+    }
+    catch (const std::invalid_argument& e)
     {
-        auto iter = pendingAttribute.find(pair.first);
-        if (iter != pendingAttribute.end())
+        lg2::error("Ignoring invalid attribute dependencies: {ERROR}", "ERROR",
+                   e);
+    }
+}
+
+void Manager::setDependencies(std::string rules)
+{
+    std::vector<AttributeDependencies::Rule> parsed;
+    try
+    {
+        parsed = AttributeDependencies::parse(rules);
+    }
+    catch (const std::invalid_argument& e)
+    {
+        lg2::error("Invalid attribute dependencies: {ERROR}", "ERROR", e);
+        throw InvalidArgument();
+    }
+
+    dependencies.assign(std::move(parsed));
+    evaluateDependencies();
+    scheduler.files().replace(dependenciesFile, std::move(rules));
+    lg2::info("Loaded {COUNT} attribute dependencies", "COUNT",
+              dependencies.size());
+}
+
+Manager::AttributeState Manager::getAttributeState(AttributeName attribute)
+{
+    // Served from the latest snapshot, like GetAttribute
+    auto state = snapshots.latest().state(attribute);
+    if (!state)
+    {
+        throw AttributeNotFound();
+    }
+    return {state->readOnly, state->hidden, state->lowerBound,
+            state->upperBound};
+}
+
+void Manager::applyPending(const PendingAttributes& delta)
+{
+    auto pending = snapshots.editPending();
+    for (const auto& [name, attr] : delta)
+    {
+        pending->insert_or_assign(name, attr);
+        validatedPending[attributes->index(*attributes->find(name))] = true;
+    }
+
+    publish(std::move(pending));
+    signalPending();
+    persistPending(delta);
+    updateSizeMetrics();
+}
+
+void Manager::persistPending(const PendingAttributes& value)
+{
+    if (value.empty())
+    {
+        journalClear = true;
+        journalDelta.clear();
+    }
+    for (const auto& [name, attr] : value)
+    {
+        journalDelta.insert_or_assign(name, attr);
+    }
+
+    scheduler.markDirty(writerId);
+}
+
+void Manager::persist()
+{
+    auto& files = scheduler.files();
+
+    // A record that did not make it to the file leaves a gap in the journal,
+    // and a snapshot that did not replace it leaves the journal on the old
+    // snapshot; the writer refuses the appends queued after either. Replace
+    // the file with a snapshot at the next commit.
+    auto done = [this](bool ok) {
+        if (!ok && !snapshotDirty)
         {
-            iter = pendingAttribute.erase(iter);
+            snapshotDirty = true;
+            scheduler.markDirty(writerId);
         }
+    };
 
-        pendingAttribute.emplace(std::make_pair(pair.first, pair.second));
+    if (!snapshotDirty)
+    {
+        if (!journalTableUpserts.empty() || !journalTableRemovals.empty())
+        {
+            auto record =
+                encodeJournal(journalTableUpserts, journalTableRemovals);
+            journalSize += record.size();
+            files.append(biosFile, std::move(record), done);
+        }
+
+        if (journalClear || !journalDelta.empty())
+        {
+            auto op = journalClear ? JournalOp::clearPending
+                                   : JournalOp::setPending;
+            auto record = encodeJournal(op, journalDelta);
+            journalSize += record.size();
+            files.append(biosFile, std::move(record), done);
+        }
+
+        snapshotDirty = (journalSize > journalCompactSize);
     }
 
-    auto pendingAttrs = Base::pendingAttributes(pendingAttribute, false);
-    serialize(*this, biosFile);
+    journalTableUpserts.clear();
+    journalTableRemovals.clear();
+    journalClear = false;
+    journalDelta.clear();
 
-    return pendingAttrs;
+    if (snapshotDirty)
+    {
+        files.replace(biosFile, encodeSnapshot(*this), done);
+        journalSize = 0;
+        snapshotDirty = false;
+    }
+}
+
+void Manager::publish(std::shared_ptr<PendingAttributes> pending,
+                      bool newTable)
+{
+    snapshots.publish(image, attributes, std::move(pending),
+                      dependencies.shared(), newTable);
+}
+
+void Manager::updateSizeMetrics()
+{
+    if (image)
+    {
+        metrics.setTableSizes(image->size(), image->pendingCount());
+        return;
+    }
+    metrics.setTableSizes(attributes->size(), pendingCount());
+}
+
+Manager::TableDiffReport Manager::getTableDiff() const
+{
+    return {lastTableDiff.added, lastTableDiff.removed, lastTableDiff.changed};
 }
 
 Manager::Manager(sdbusplus::asio::object_server& objectServer,
                  std::shared_ptr<sdbusplus::asio::connection>& systemBus,
-                 std::string persistPath) :
+                 std::string persistPath, PersistScheduler& scheduler,
+                 Metrics& metrics) :
     sdbusplus::xyz::openbmc_project::BIOSConfig::server::Manager(
         *systemBus, objectPath),
-    objServer(objectServer), systemBus(systemBus)
+    objServer(objectServer), systemBus(systemBus), scheduler(scheduler),
+    writerId(scheduler.registerWriter([this]() { persist(); })),
+    metrics(metrics),
+    readers(systemBus->get_io_context(), ATTRIBUTE_READERS, maxQueuedReads)
 {
     fs::path biosDir(persistPath);
     fs::create_directories(biosDir);
     biosFile = biosDir / biosPersistFile;
+    dependenciesFile = biosDir / biosDependenciesFile;
+    loadDependencies();
     deserialize(biosFile, *this);
+    if (image)
+    {
+        publish(nullptr, true);
+        evaluateDependencies();
+    }
+    else
+    {
+        attributes->assign(Base::baseBIOSTable());
+        Base::baseBIOSTable({}, true);
+        validatedPending.assign(attributes->size(), false);
+        publish(knownPending(Base::pendingAttributes()), true);
+        Base::pendingAttributes({}, true);
+        evaluateDependencies();
+    }
+    updateSizeMetrics();
+
+    extIface = objServer.add_interface(objectPath, managerExtInterface);
+    extIface->register_method("SetAttributes", [this](AttributeValues values) {
+        setAttributes(std::move(values));
+    });
+    extIface->register_method(
+        "GetAttributes", [this](boost::asio::yield_context yield,
+                                std::vector<AttributeName> names) {
+            return getAttributes(std::move(yield), std::move(names));
+        });
+    extIface->register_method(
+        "GetMenu", [this](boost::asio::yield_context yield, std::string path) {
+            return getMenu(std::move(yield), std::move(path));
+        });
+    extIface->register_method(
+        "GetBaseTablePage", [this](boost::asio::yield_context yield,
+                                   std::string cursor, uint32_t pageSize) {
+            return getBaseTablePage(std::move(yield), std::move(cursor),
+                                    pageSize);
+        });
+    extIface->register_method(
+        "GetPendingPage", [this](boost::asio::yield_context yield,
+                                 std::string cursor, uint32_t pageSize) {
+            return getPendingPage(std::move(yield), std::move(cursor),
+                                  pageSize);
+        });
+    extIface->register_method(
+        "BeginTableUpload", [this](sdbusplus::message_t& msg) {
+            return beginTableUpload(msg.get_sender());
+        });
+    extIface->register_method(
+        "AppendTableChunk",
+        [this](sdbusplus::message_t& msg, uint64_t id, BaseTable chunk) {
+            appendTableChunk(msg.get_sender(), id, std::move(chunk));
+        });
+    extIface->register_method(
+        "CommitTableUpload", [this](sdbusplus::message_t& msg, uint64_t id) {
+            commitTableUpload(msg.get_sender(), id);
+        });
+    extIface->register_method(
+        "AbortTableUpload", [this](sdbusplus::message_t& msg, uint64_t id) {
+            abortTableUpload(msg.get_sender(), id);
+        });
+    extIface->register_method("GetTableDiff",
+                              [this]() { return getTableDiff(); });
+    extIface->register_method("SetDependencies", [this](std::string rules) {
+        setDependencies(std::move(rules));
+    });
+    extIface->register_method(
+        "GetAttributeState",
+        [this](std::string attribute) { return getAttributeState(attribute); });
+    extIface->initialize();
 }
 
 } // namespace bios_config
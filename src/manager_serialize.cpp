@@ -1,8 +1,13 @@
 #include "manager_serialize.hpp"
 
+#include "bios_image.hpp"
+#include "compression.hpp"
+#include "file_writer.hpp"
+
 #include <cereal/archives/binary.hpp>
 #include <cereal/cereal.hpp>
 #include <cereal/types/map.hpp>
+#include <cereal/types/set.hpp>
 #include <cereal/types/string.hpp>
 #include <cereal/types/tuple.hpp>
 #include <cereal/types/variant.hpp>
@@ -10,29 +15,15 @@
 #include <phosphor-logging/lg2.hpp>
 
 #include <fstream>
+#include <spanstream>
+#include <sstream>
 
 namespace bios_config
 {
 
-/** @brief Function required by Cereal to perform serialization.
- *
- *  @tparam Archive - Cereal archive type (binary in this case).
- *  @param[in] archive - reference to cereal archive.
- *  @param[in] entry- const reference to bios manager object
- *  @param[in] version - Class version that enables handling a serialized data
- *                       across code levels
- */
-template <class Archive>
-void save(Archive& archive, const Manager& entry,
-          const std::uint32_t /*version*/)
-{
-    archive(entry.sdbusplus::xyz::openbmc_project::BIOSConfig::server::Manager::
-                baseBIOSTable(),
-            entry.sdbusplus::xyz::openbmc_project::BIOSConfig::server::Manager::
-                pendingAttributes());
-}
-
-/** @brief Function required by Cereal to perform deserialization.
+/** @brief Function required by Cereal to perform deserialization. Snapshots
+ *         are only read in the cereal format when a file written before the
+ *         indexed image format is converted.
  *
  *  @tparam Archive - Cereal archive type (binary in our case).
  *  @param[in] archive - reference to cereal archive.
@@ -53,26 +44,140 @@ void load(Archive& archive, Manager& entry, const std::uint32_t /*version*/)
         pendingAttributes(pendingAttrs, true);
 }
 
-void serialize(const Manager& obj, const fs::path& path)
+size_t serialize(const Manager& obj, const fs::path& path)
 {
     try
     {
-        std::ofstream os(path, std::ios::out | std::ios::binary);
-
-        if (!os.is_open())
+        auto image = encodeSnapshot(obj);
+        if (!FileWriter::replaceFile(path, image))
         {
-            lg2::error("Failed to open file for serialization: {FILE}", "FILE",
-                       path);
-            return;
+            return 0;
         }
-
-        cereal::BinaryOutputArchive oarchive(os);
-        oarchive(obj);
+        return image.size();
     }
     catch (const std::exception& e)
     {
         lg2::error("Failed to Serialize : {ERROR} ", "ERROR", e);
+        return 0;
+    }
+}
+
+std::string encodeSnapshot(const Manager& obj)
+{
+    return compression::compress(
+        BiosImage::encode(obj.baseBIOSTable(), obj.pendingAttributes()));
+}
+
+std::string encodeJournal(JournalOp op, const Manager::PendingAttributes& delta)
+{
+    std::ostringstream record(std::ios::out | std::ios::binary);
+    {
+        cereal::BinaryOutputArchive oarchive(record);
+        oarchive(static_cast<uint8_t>(op), delta);
+    }
+    return std::move(record).str();
+}
+
+std::string encodeJournal(const Manager::BaseTable& upserts,
+                          const std::set<std::string>& removals)
+{
+    std::ostringstream record(std::ios::out | std::ios::binary);
+    {
+        cereal::BinaryOutputArchive oarchive(record);
+        oarchive(static_cast<uint8_t>(JournalOp::updateTable), upserts,
+                 removals);
+    }
+    return std::move(record).str();
+}
+
+/** @brief Replay the journal records that follow the snapshot.
+ *
+ *  @param[in] is - stream positioned after the snapshot
+ *  @param[in] iarchive - archive reading from the stream
+ *  @param[out] entry - reference to bios manager object
+ *
+ *  @return Number of records replayed.
+ */
+static size_t replayJournal(std::istream& is,
+                            cereal::BinaryInputArchive& iarchive,
+                            Manager& entry)
+{
+    auto baseTable = entry.sdbusplus::xyz::openbmc_project::BIOSConfig::
+                         server::Manager::baseBIOSTable();
+    auto pendingAttrs = entry.sdbusplus::xyz::openbmc_project::BIOSConfig::
+                            server::Manager::pendingAttributes();
+    size_t records = 0;
+
+    try
+    {
+        while (is.peek() != std::istream::traits_type::eof())
+        {
+            uint8_t op = 0;
+            iarchive(op);
+
+            if (op > static_cast<uint8_t>(JournalOp::updateTable))
+            {
+                // Not a record this version writes: the journal ends at the
+                // corruption, as it does at a truncated record. Count it so
+                // that the file gets compacted.
+                lg2::error("Unknown journal record {OP} after {RECORDS} "
+                           "records",
+                           "OP", op, "RECORDS", records);
+                records++;
+                break;
+            }
+
+            if (static_cast<JournalOp>(op) == JournalOp::updateTable)
+            {
+                Manager::BaseTable upserts;
+                std::set<std::string> removals;
+                iarchive(upserts, removals);
+
+                for (const auto& name : removals)
+                {
+                    baseTable.erase(name);
+                }
+                for (auto& [name, attr] : upserts)
+                {
+                    baseTable.insert_or_assign(name, std::move(attr));
+                }
+                records++;
+                continue;
+            }
+
+            Manager::PendingAttributes delta;
+            iarchive(delta);
+
+            if (static_cast<JournalOp>(op) == JournalOp::clearPending)
+            {
+                pendingAttrs.clear();
+            }
+            for (auto& [name, value] : delta)
+            {
+                pendingAttrs.insert_or_assign(name, std::move(value));
+            }
+            records++;
+        }
+    }
+    catch (const std::exception& e)
+    {
+        // A record cut short by a crash or power loss ends the journal, the
+        // records before it are still valid. Count it so that the file gets
+        // compacted.
+        lg2::error("Journal truncated after {RECORDS} records: {ERROR}",
+                   "RECORDS", records, "ERROR", e);
+        records++;
     }
+
+    if (records != 0)
+    {
+        entry.sdbusplus::xyz::openbmc_project::BIOSConfig::server::Manager::
+            baseBIOSTable(baseTable, true);
+        entry.sdbusplus::xyz::openbmc_project::BIOSConfig::server::Manager::
+            pendingAttributes(pendingAttrs, true);
+    }
+
+    return records;
 }
 
 bool deserialize(const fs::path& path, Manager& entry)
@@ -81,15 +186,46 @@ bool deserialize(const fs::path& path, Manager& entry)
     {
         if (fs::exists(path))
         {
-            std::ifstream is(path.c_str(), std::ios::in | std::ios::binary);
-            if (!is.is_open())
+            auto image = BiosImage::open(path);
+            if (image && image->journal().empty())
             {
-                lg2::error("Failed to open file for deserialization: {FILE}",
-                           "FILE", path);
-                return false;
+                // Nothing to replay, the image is queried in place
+                entry.useImage(std::move(image));
+                return true;
             }
-            cereal::BinaryInputArchive iarchive(is);
-            iarchive(entry);
+
+            if (image)
+            {
+                entry.sdbusplus::xyz::openbmc_project::BIOSConfig::server::
+                    Manager::baseBIOSTable(image->baseTable(), true);
+                entry.sdbusplus::xyz::openbmc_project::BIOSConfig::server::
+                    Manager::pendingAttributes(image->pendingAttributes(),
+                                               true);
+
+                std::ispanstream is(image->journal());
+                cereal::BinaryInputArchive iarchive(is);
+                replayJournal(is, iarchive, entry);
+            }
+            else
+            {
+                // Files written before the indexed image format hold a cereal
+                // snapshot; the snapshot below converts them.
+                std::ifstream is(path.c_str(),
+                                 std::ios::in | std::ios::binary);
+                if (!is.is_open())
+                {
+                    lg2::error(
+                        "Failed to open file for deserialization: {FILE}",
+                        "FILE", path);
+                    return false;
+                }
+                cereal::BinaryInputArchive iarchive(is);
+                iarchive(entry);
+
+                replayJournal(is, iarchive, entry);
+            }
+
+            serialize(entry, path);
             return true;
         }
         return false;
@@ -97,7 +233,9 @@ bool deserialize(const fs::path& path, Manager& entry)
     catch (const std::exception& e)
     {
         lg2::error("Failed to deserialize: {ERROR}", "ERROR", e);
-        fs::remove(path);
+        // The file may only be unreadable by this build, like a container
+        // compressed with a dictionary that is not installed; keep it
+        FileWriter::setAside(path);
         return false;
     }
 }
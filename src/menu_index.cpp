@@ -0,0 +1,77 @@
+#include "menu_index.hpp"
+
+namespace bios_config
+{
+
+/** @brief Take the next submenu name off the front of a menu path.
+ *
+ *  @param[in,out] rest - remainder of the path
+ *
+ *  @return The submenu name, empty once the path is exhausted
+ */
+static std::string_view nextComponent(std::string_view& rest)
+{
+    while (!rest.empty())
+    {
+        auto end = rest.find('/');
+        auto component = rest.substr(0, end);
+        rest.remove_prefix(end == std::string_view::npos ? rest.size()
+                                                         : end + 1);
+        if (!component.empty() && component != ".")
+        {
+            return component;
+        }
+    }
+    return {};
+}
+
+void MenuIndex::clear()
+{
+    nodes.clear();
+    nodes.emplace_back();
+}
+
+void MenuIndex::add(std::string_view menuPath, uint32_t attribute)
+{
+    uint32_t current = 0;
+    for (auto name = nextComponent(menuPath); !name.empty();
+         name = nextComponent(menuPath))
+    {
+        auto& children = nodes[current].children;
+        auto iter = children.find(name);
+        if (iter == children.end())
+        {
+            auto child = static_cast<uint32_t>(nodes.size());
+            // Insert before growing nodes, which moves the children maps
+            children.emplace_hint(iter, name, child);
+            nodes.emplace_back();
+            current = child;
+        }
+        else
+        {
+            current = iter->second;
+        }
+    }
+
+    nodes[current].attributes.push_back(attribute);
+}
+
+const MenuIndex::Node* MenuIndex::find(std::string_view path) const
+{
+    uint32_t current = 0;
+    for (auto name = nextComponent(path); !name.empty();
+         name = nextComponent(path))
+    {
+        const auto& children = nodes[current].children;
+        auto iter = children.find(name);
+        if (iter == children.end())
+        {
+            return nullptr;
+        }
+        current = iter->second;
+    }
+
+    return &nodes[current];
+}
+
+} // namespace bios_config
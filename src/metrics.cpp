@@ -0,0 +1,204 @@
+#include "metrics.hpp"
+
+#include <charconv>
+
+namespace bios_config
+{
+
+static constexpr std::array<std::string_view, Metrics::handlerCount>
+    handlerNames = {
+        "GetAttribute",
+        "GetAttributes",
+        "GetMenu",
+        "GetBaseTablePage",
+        "GetPendingPage",
+        "SetAttribute",
+        "SetAttributes",
+        "PendingAttributes",
+        "BaseBIOSTable",
+        "ChangePassword",
+        "CurrentBoot",
+        "PendingEnable",
+        "Mode",
+};
+
+/** @brief Format a number in the shortest form that reads back exactly.
+ */
+static std::string formatNumber(double value)
+{
+    std::array<char, 32> buffer{};
+    auto result =
+        std::to_chars(buffer.data(), buffer.data() + buffer.size(), value);
+    return {buffer.data(), result.ptr};
+}
+
+/** @brief Append a sample line: name{labels} value
+ */
+static void appendSample(std::string& out, std::string_view name,
+                         std::string_view labels, std::string_view value)
+{
+    out += name;
+    if (!labels.empty())
+    {
+        out += '{';
+        out += labels;
+        out += '}';
+    }
+    out += ' ';
+    out += value;
+    out += '\n';
+}
+
+static void appendSample(std::string& out, std::string_view name,
+                         std::string_view labels, uint64_t value)
+{
+    appendSample(out, name, labels, std::to_string(value));
+}
+
+static void appendHeader(std::string& out, std::string_view name,
+                         std::string_view type, std::string_view help)
+{
+    out += "# HELP ";
+    out += name;
+    out += ' ';
+    out += help;
+    out += "\n# TYPE ";
+    out += name;
+    out += ' ';
+    out += type;
+    out += '\n';
+}
+
+void Histogram::write(std::string& out, std::string_view name,
+                      std::string_view labels) const
+{
+    const auto bucketName = std::string(name) + "_bucket";
+    const auto bucketLabels =
+        labels.empty() ? std::string() : std::string(labels) + ",";
+
+    uint64_t cumulative = 0;
+    for (size_t i = 0; i < bucketCount; i++)
+    {
+        cumulative += buckets[i].load(std::memory_order_relaxed);
+
+        // Upper bound of the bucket in seconds
+        auto bound = i == bucketCount - 1
+                         ? std::string("+Inf")
+                         : formatNumber(
+                               static_cast<double>(uint64_t{1} << i) / 1e6);
+        appendSample(out, bucketName, bucketLabels + "le=\"" + bound + "\"",
+                     cumulative);
+    }
+
+    appendSample(
+        out, std::string(name) + "_sum", labels,
+        formatNumber(static_cast<double>(sum.load(std::memory_order_relaxed)) /
+                     1e9));
+    appendSample(out, std::string(name) + "_count", labels,
+                 count.load(std::memory_order_relaxed));
+}
+
+Metrics::Metrics(sdbusplus::asio::object_server& objectServer)
+{
+    iface = objectServer.add_interface(metricsObjectPath, metricsInterface);
+    iface->register_property_r<uint64_t>(
+        "ValidationFailures", 0, sdbusplus::vtable::property_::none,
+        [this](const auto&) {
+            return validationFailures.load(std::memory_order_relaxed);
+        });
+    iface->register_property_r<uint64_t>(
+        "PersistedBytes", 0, sdbusplus::vtable::property_::none,
+        [this](const auto&) {
+            return persistedBytes.load(std::memory_order_relaxed);
+        });
+    iface->register_property_r<uint64_t>(
+        "PasswordChangesAdmitted", 0, sdbusplus::vtable::property_::none,
+        [this](const auto&) {
+            return passwordAdmitted.load(std::memory_order_relaxed);
+        });
+    iface->register_property_r<uint64_t>(
+        "PasswordChangesRejected", 0, sdbusplus::vtable::property_::none,
+        [this](const auto&) {
+            return passwordRejected.load(std::memory_order_relaxed);
+        });
+    iface->register_property_r<uint64_t>(
+        "BaseTableSize", 0, sdbusplus::vtable::property_::none,
+        [this](const auto&) {
+            return tableSize.load(std::memory_order_relaxed);
+        });
+    iface->register_property_r<uint64_t>(
+        "PendingAttributesSize", 0, sdbusplus::vtable::property_::none,
+        [this](const auto&) {
+            return pendingSize.load(std::memory_order_relaxed);
+        });
+    iface->register_method("Dump", [this]() { return dump(); });
+    iface->initialize();
+}
+
+std::string Metrics::dump() const
+{
+    std::string out;
+
+    constexpr auto handlerDuration = "biosconfig_handler_duration_seconds";
+    appendHeader(out, handlerDuration, "histogram",
+                 "Time spent handling D-Bus calls.");
+    for (size_t i = 0; i < handlerCount; i++)
+    {
+        latencies[i].write(out, handlerDuration,
+                           "handler=\"" + std::string(handlerNames[i]) + "\"");
+    }
+
+    constexpr auto handlerErrors = "biosconfig_handler_errors_total";
+    appendHeader(out, handlerErrors, "counter",
+                 "D-Bus calls that returned an error.");
+    for (size_t i = 0; i < handlerCount; i++)
+    {
+        appendSample(out, handlerErrors,
+                     "handler=\"" + std::string(handlerNames[i]) + "\"",
+                     errors[i].load(std::memory_order_relaxed));
+    }
+
+    constexpr auto persistDuration = "biosconfig_persist_duration_seconds";
+    appendHeader(out, persistDuration, "histogram",
+                 "Time spent encoding state for persistent storage.");
+    persistLatency.write(out, persistDuration, "");
+
+    constexpr auto writeDuration = "biosconfig_write_duration_seconds";
+    appendHeader(out, writeDuration, "histogram",
+                 "Time the writer thread spent writing and syncing a file.");
+    writeLatency.write(out, writeDuration, "");
+
+    constexpr auto persisted = "biosconfig_persisted_bytes_total";
+    appendHeader(out, persisted, "counter",
+                 "Bytes of BIOS settings written to persistent storage.");
+    appendSample(out, persisted, "",
+                 persistedBytes.load(std::memory_order_relaxed));
+
+    constexpr auto failures = "biosconfig_validation_failures_total";
+    appendHeader(out, failures, "counter",
+                 "Values rejected by the validation against the table.");
+    appendSample(out, failures, "",
+                 validationFailures.load(std::memory_order_relaxed));
+
+    constexpr auto passwords = "biosconfig_password_changes_total";
+    appendHeader(out, passwords, "counter",
+                 "Password changes admitted to or rejected before the key "
+                 "derivation.");
+    appendSample(out, passwords, "result=\"admitted\"",
+                 passwordAdmitted.load(std::memory_order_relaxed));
+    appendSample(out, passwords, "result=\"rejected\"",
+                 passwordRejected.load(std::memory_order_relaxed));
+
+    constexpr auto table = "biosconfig_base_table_attributes";
+    appendHeader(out, table, "gauge", "Attributes in the BaseBIOSTable.");
+    appendSample(out, table, "", tableSize.load(std::memory_order_relaxed));
+
+    constexpr auto pending = "biosconfig_pending_attributes";
+    appendHeader(out, pending, "gauge", "Attributes with a pending value.");
+    appendSample(out, pending, "",
+                 pendingSize.load(std::memory_order_relaxed));
+
+    return out;
+}
+
+} // namespace bios_config
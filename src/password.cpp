@@ -18,6 +18,9 @@
 #include "xyz/openbmc_project/BIOSConfig/Common/error.hpp"
 #include "xyz/openbmc_project/Common/error.hpp"
 
+#include <openssl/crypto.h>
+#include <sys/stat.h>
+
 #include <boost/algorithm/hex.hpp>
 #include <boost/asio.hpp>
 #include <phosphor-logging/elog-errors.hpp>
@@ -25,34 +28,31 @@
 #include <sdbusplus/asio/connection.hpp>
 #include <sdbusplus/asio/object_server.hpp>
 
+#include <exception>
 #include <fstream>
 #include <iostream>
+#include <iterator>
 
 namespace bios_config_pwd
 {
 using namespace sdbusplus::xyz::openbmc_project::Common::Error;
 using namespace sdbusplus::xyz::openbmc_project::BIOSConfig::Common::Error;
 
-bool Password::compareDigest(const EVP_MD* digestFunc, size_t digestLen,
-                             const std::array<uint8_t, maxHashSize>& expected,
-                             const std::array<uint8_t, maxSeedSize>& seed,
-                             const std::string& rawData)
+bool Password::compareDigest(const KdfParams& kdf, const Hash& expected,
+                             const Seed& seed, const std::string& rawData)
 {
-    std::vector<uint8_t> output(digestLen);
-    unsigned int hashLen = digestLen;
-
-    if (!PKCS5_PBKDF2_HMAC(reinterpret_cast<const char*>(rawData.c_str()),
-                           rawData.length() + 1,
-                           reinterpret_cast<const unsigned char*>(seed.data()),
-                           seed.size(), iterValue, digestFunc, hashLen,
-                           output.data()))
+    Hash output{};
+    if (!deriveKey(kdf, rawData, seed, output))
     {
-        lg2::error("Generate PKCS5_PBKDF2_HMAC Integrity Check Value failed");
+        lg2::error("Generate {ALGO} Integrity Check Value failed", "ALGO",
+                   kdf.algorithm);
         throw InternalFailure();
     }
 
-    if (std::memcmp(output.data(), expected.data(),
-                    output.size() * sizeof(uint8_t)) == 0)
+    // Constant time, the time taken must not tell how much of the hash
+    // matched
+    if (CRYPTO_memcmp(output.data(), expected.data(),
+                      hashLength(kdf.algorithm)) == 0)
     {
         return true;
     }
@@ -60,201 +60,385 @@ bool Password::compareDigest(const EVP_MD* digestFunc, size_t digestLen,
     return false;
 }
 
-bool Password::isMatch(const std::array<uint8_t, maxHashSize>& expected,
-                       const std::array<uint8_t, maxSeedSize>& seed,
-                       const std::string& rawData, const std::string& algo)
+bool Password::isMatch(const Hash& expected, const Seed& seed,
+                       const std::string& rawData, const KdfParams& kdf)
 {
     lg2::error("isMatch");
 
-    if (algo == "SHA256")
-    {
-        return compareDigest(EVP_sha256(), SHA256_DIGEST_LENGTH, expected, seed,
-                             rawData);
-    }
-
-    if (algo == "SHA384")
+    if (hashLength(kdf.algorithm) == 0)
     {
-        return compareDigest(EVP_sha384(), SHA384_DIGEST_LENGTH, expected, seed,
-                             rawData);
+        return false;
     }
 
-    return false;
+    return compareDigest(kdf, expected, seed, rawData);
 }
 
-bool Password::getParam(std::array<uint8_t, maxHashSize>& orgUsrPwdHash,
-                        std::array<uint8_t, maxHashSize>& orgAdminPwdHash,
-                        std::array<uint8_t, maxSeedSize>& seed,
-                        std::string& hashAlgo)
+bool Password::verifyIntegrityCheck(const std::string& newPassword,
+                                    const Seed& seed, const KdfParams& kdf,
+                                    Hash& newHash)
 {
-    try
-    {
-        nlohmann::json json = nullptr;
-        std::ifstream ifs(seedFile.c_str());
-        if (ifs.is_open())
-        {
-            try
-            {
-                json = nlohmann::json::parse(ifs, nullptr, false);
-            }
-            catch (const nlohmann::json::parse_error& e)
-            {
-                lg2::error("Failed to parse JSON file: {ERROR}", "ERROR", e);
-                return false;
-            }
+    newHash.fill(0);
 
-            if (!json.is_discarded())
-            {
-                orgUsrPwdHash = json["UserPwdHash"];
-                orgAdminPwdHash = json["AdminPwdHash"];
-                seed = json["Seed"];
-                hashAlgo = json["HashAlgo"];
-            }
-        }
-    }
-    catch (nlohmann::detail::exception& e)
+    if (!deriveKey(kdf, newPassword, seed, newHash))
     {
-        lg2::error("Failed to parse JSON file: {ERROR}", "ERROR", e);
+        lg2::error("Verify {ALGO} Integrity Check failed", "ALGO",
+                   kdf.algorithm);
         return false;
     }
 
     return true;
 }
 
-bool Password::verifyIntegrityCheck(
-    std::string& newPassword, std::array<uint8_t, maxSeedSize>& seed,
-    unsigned int mdLen, const EVP_MD* digestFunc)
+Hash Password::verifyPassword(const SeedParams& params,
+                              const std::string& userName,
+                              const std::string& currentPassword,
+                              const std::string& newPassword,
+                              const KdfParams& newKdf)
 {
-    mNewPwdHash.fill(0);
-
-    if (!PKCS5_PBKDF2_HMAC(reinterpret_cast<const char*>(newPassword.c_str()),
-                           newPassword.length() + 1,
-                           reinterpret_cast<const unsigned char*>(seed.data()),
-                           seed.size(), iterValue, digestFunc, mdLen,
-                           mNewPwdHash.data()))
+    Hash newHash{};
+    const bool admin = (userName == "AdminPassword");
+    const auto& kdf = admin ? params.adminKdf : params.userKdf;
+    if (kdf.algorithm.empty())
     {
-        lg2::error("Verify PKCS5_PBKDF2_HMAC Integrity Check failed");
-        return false;
+        return newHash;
     }
 
-    return true;
+    if (!isMatch(admin ? params.adminPwdHash : params.userPwdHash,
+                 params.seed, currentPassword, kdf))
+    {
+        throw InvalidCurrentPassword();
+    }
+    if (!verifyIntegrityCheck(newPassword, params.seed, newKdf, newHash))
+    {
+        throw InternalFailure();
+    }
+    return newHash;
 }
 
-void Password::verifyPassword(std::string userName, std::string currentPassword,
+void Password::changePassword(boost::asio::yield_context yield,
+                              const std::string& caller, std::string userName,
+                              std::string currentPassword,
                               std::string newPassword)
 {
-    if (fs::exists(seedFile.c_str()))
+    auto timer = metrics.time(bios_config::Metrics::Handler::changePassword);
+    lg2::debug("BIOS config changePassword");
+
+    // The admission is keyed on the hash the change targets, not on the
+    // user name the caller made up
+    const std::string target =
+        (userName == "AdminPassword") ? "admin" : "user";
+    auto decision = admission.admit(caller, target);
+    metrics.countPasswordAdmission(decision ==
+                                   AdmissionControl::Decision::admitted);
+    if (decision == AdmissionControl::Decision::rateLimited)
+    {
+        lg2::error("Too many password changes from {CALLER} for {TARGET}",
+                   "CALLER", caller, "TARGET", target);
+        throw Unavailable();
+    }
+    if (decision == AdmissionControl::Decision::lockedOut)
     {
-        std::array<uint8_t, maxHashSize> orgUsrPwdHash;
-        std::array<uint8_t, maxHashSize> orgAdminPwdHash;
-        std::array<uint8_t, maxSeedSize> seed;
-        std::string hashAlgo = "";
+        lg2::error(
+            "Password changes from {CALLER} for {TARGET} are locked out",
+            "CALLER", caller, "TARGET", target);
+        throw Unavailable();
+    }
 
-        if (getParam(orgUsrPwdHash, orgAdminPwdHash, seed, hashAlgo))
-        {
-            if (orgUsrPwdHash.empty() || orgAdminPwdHash.empty() ||
-                seed.empty() || hashAlgo.empty())
-            {
-                return;
-            }
-        }
-        else
-        {
-            throw InternalFailure();
-        }
+    const auto* stored = loadSeedData();
+    if (stored == nullptr)
+    {
+        throw InternalFailure();
+    }
+    auto params = stored->record.params;
 
-        if (userName == "AdminPassword")
-        {
-            if (!isMatch(orgAdminPwdHash, seed, currentPassword, hashAlgo))
+    // Hash the new password at the calibrated cost, if there is one
+    auto newKdf = newHashKdf.value_or(params.adminKdf);
+
+    // The key derivations run on a worker, the io context keeps serving
+    // the other requests until they are done
+    struct Result
+    {
+        Hash newHash{};
+        std::exception_ptr error;
+    };
+    auto result = std::make_shared<Result>();
+    boost::system::error_code ec;
+    workers.run(
+        [result, params, newKdf, userName,
+         currentPassword = std::move(currentPassword),
+         newPassword = std::move(newPassword)]() {
+            try
             {
-                throw InvalidCurrentPassword();
+                result->newHash = verifyPassword(
+                    params, userName, currentPassword, newPassword, newKdf);
             }
-        }
-        else
-        {
-            if (!isMatch(orgUsrPwdHash, seed, currentPassword, hashAlgo))
+            catch (...)
             {
-                throw InvalidCurrentPassword();
+                result->error = std::current_exception();
             }
-        }
-        if (hashAlgo == "SHA256")
+        },
+        yield[ec]);
+    if (ec)
+    {
+        lg2::error("Too many password changes in progress");
+        throw Unavailable();
+    }
+    if (result->error)
+    {
+        try
         {
-            if (!verifyIntegrityCheck(newPassword, seed, 32, EVP_sha256()))
-            {
-                throw InternalFailure();
-            }
+            std::rethrow_exception(result->error);
         }
-        if (hashAlgo == "SHA384")
+        catch (const InvalidCurrentPassword&)
         {
-            if (!verifyIntegrityCheck(newPassword, seed, 48, EVP_sha384()))
-            {
-                throw InternalFailure();
-            }
+            admission.recordFailure(caller, target);
+            throw;
         }
+    }
+
+    // Another change may have completed while this one was verified, the
+    // current password was then checked against a stale hash. Unless the
+    // store changed, this does not read it again.
+    stored = loadSeedData();
+    if (stored == nullptr || stored->record.params != params)
+    {
+        lg2::error("BIOS password changed during the verification");
+        throw InvalidCurrentPassword();
+    }
+
+    auto& record = seedData->record;
+    record.params.adminPwdHash = result->newHash;
+    record.params.adminKdf = newKdf;
+    record.isAdminPwdChanged = true;
+    password_store::toJson(record, seedData->document);
+
+    // Not coalesced: the provisioning path may rewrite the seed data at any
+    // time, and the longer the change only lives in memory, the wider the
+    // window in which one of the two writes is lost
+    unsavedSeedFile = true;
+    unsavedStore = true;
+    writeSeedData();
+    admission.recordSuccess(caller, target);
+}
+
+std::optional<Password::FileStamp>
+    Password::FileStamp::of(const std::filesystem::path& path)
+{
+    struct stat st{};
+    if (::stat(path.c_str(), &st) != 0)
+    {
+        return std::nullopt;
+    }
+    return FileStamp{st.st_dev, st.st_ino, st.st_size, st.st_mtim.tv_sec,
+                     st.st_mtim.tv_nsec};
+}
+
+bool Password::importSeedFile()
+{
+    std::ifstream ifs(seedFile.c_str());
+    auto document = nlohmann::json::parse(ifs, nullptr, false);
+    if (document.is_discarded())
+    {
+        lg2::error("Failed to parse the seed data file {FILE}", "FILE",
+                   seedFile);
+        return false;
+    }
+
+    PasswordRecord record;
+    try
+    {
+        record = password_store::fromJson(document);
+    }
+    catch (const std::exception& e)
+    {
+        lg2::error("Failed to parse JSON file: {ERROR}", "ERROR", e);
+        return false;
+    }
+
+    // The store is written again only when it does not hold the file
+    if (!seedData)
+    {
+        readStore();
+    }
+    const bool cached = seedData && seedData->record == record;
+    seedData = SeedData{std::move(record), std::move(document)};
+    if (!cached)
+    {
+        lg2::info("Caching the seed data file {FILE} in {STORE}", "FILE",
+                  seedFile, "STORE", storeFile);
+        unsavedStore = true;
+        scheduler.markDirty(writerId);
+    }
+    return true;
+}
+
+void Password::readStore()
+{
+    seedData.reset();
+    std::ifstream ifs(storeFile.c_str(), std::ios::binary);
+    if (!ifs.is_open())
+    {
         return;
     }
-    throw InternalFailure();
+    std::string data((std::istreambuf_iterator<char>(ifs)),
+                     std::istreambuf_iterator<char>());
+    try
+    {
+        SeedData stored{password_store::decode(data), nullptr};
+        password_store::toJson(stored.record, stored.document);
+        seedData = std::move(stored);
+    }
+    catch (const std::runtime_error& e)
+    {
+        lg2::error("Failed to read the password store {FILE}: {ERROR}",
+                   "FILE", storeFile, "ERROR", e);
+    }
 }
-void Password::changePassword(std::string userName, std::string currentPassword,
-                              std::string newPassword)
+
+const Password::SeedData* Password::loadSeedData()
 {
-    lg2::debug("BIOS config changePassword");
-    verifyPassword(userName, currentPassword, newPassword);
+    // The files are older than the change that is not written yet. A seed
+    // data file written meanwhile must not drop the change, it is read once
+    // the change is written.
+    if (unsavedSeedFile || unsavedStore || seedWritesInFlight > 0)
+    {
+        return &*seedData;
+    }
+
+    auto stamp = FileStamp::of(seedFile);
+    if (seedData && stamp == seenSeedFile)
+    {
+        return &*seedData;
+    }
 
-    std::ifstream fs(seedFile.c_str());
-    nlohmann::json json = nullptr;
+    // A writer replacing the file between the stat and the parse leaves
+    // the old stamp with the new content, which only costs another parse
+    seenSeedFile = stamp;
+    if (stamp && importSeedFile())
+    {
+        return &*seedData;
+    }
 
-    if (fs.is_open())
+    readStore();
+    if (!seedData)
     {
-        try
-        {
-            json = nlohmann::json::parse(fs, nullptr, false);
-        }
-        catch (const nlohmann::json::parse_error& e)
-        {
-            lg2::error("Failed to parse JSON file: {ERROR}", "ERROR", e);
-            throw InternalFailure();
-        }
+        return nullptr;
+    }
+    lg2::error("Seed data file {FILE} is missing or unreadable, using the "
+               "copy in {STORE}",
+               "FILE", seedFile, "STORE", storeFile);
+    return &*seedData;
+}
 
-        if (json.is_discarded())
-        {
-            throw InternalFailure();
-        }
-        json["AdminPwdHash"] = mNewPwdHash;
-        json["IsAdminPwdChanged"] = true;
+void Password::calibrateKdf(const std::string& algorithm)
+{
+    auto calibrated = std::make_shared<KdfParams>();
+    workers.submit(
+        [calibrated, algorithm]() {
+            *calibrated = calibrate(
+                algorithm, std::chrono::milliseconds(PASSWORD_KDF_BUDGET_MS));
+        },
+        [this, calibrated]() {
+            lg2::info("Hashing new BIOS passwords with {ALGO}, {ITERATIONS} "
+                      "iterations, memory cost {MEMORY_COST}",
+                      "ALGO", calibrated->algorithm, "ITERATIONS",
+                      calibrated->iterations, "MEMORY_COST",
+                      calibrated->memoryCost);
+            newHashKdf = *calibrated;
+        });
+}
+
+void Password::writeSeedData()
+{
+    if (unsavedSeedFile)
+    {
+        unsavedSeedFile = false;
+        seedWritesInFlight++;
+        scheduler.files().replace(
+            seedFile, seedData->document.dump(4),
+            [this](bool ok) { seedDataWritten(ok, seedFile); });
+    }
+    if (unsavedStore)
+    {
+        unsavedStore = false;
+        seedWritesInFlight++;
+        scheduler.files().replace(
+            storeFile, password_store::encode(seedData->record),
+            [this](bool ok) { seedDataWritten(ok, storeFile); });
+    }
+}
 
-        std::ofstream ofs(seedFile.c_str(), std::ios::out);
-        const auto& writeData = json.dump(4);
-        ofs << writeData;
-        ofs.close();
+void Password::seedDataWritten(bool ok, const std::filesystem::path& file)
+{
+    seedWritesInFlight--;
+    if (!ok)
+    {
+        // Retried after the commit window instead of in a tight loop
+        lg2::error("Failed to write the seed data to {FILE}", "FILE", file);
+        (file == seedFile ? unsavedSeedFile : unsavedStore) = true;
+        scheduler.markDirty(writerId);
+        return;
     }
-    else
+
+    // Our own write must not make the next request read the file again
+    wroteSeedFile = wroteSeedFile || file == seedFile;
+    if (seedWritesInFlight == 0 && !unsavedSeedFile && !unsavedStore &&
+        wroteSeedFile)
     {
-        lg2::debug("Cannot open file stream");
-        throw InternalFailure();
+        seenSeedFile = FileStamp::of(seedFile);
+        wroteSeedFile = false;
     }
 }
+
 Password::Password(sdbusplus::asio::object_server& objectServer,
                    std::shared_ptr<sdbusplus::asio::connection>& systemBus,
-                   std::string persistPath) :
-    sdbusplus::xyz::openbmc_project::BIOSConfig::server::Password(
-        *systemBus, objectPathPwd)
+                   std::string persistPath,
+                   bios_config::PersistScheduler& scheduler,
+                   bios_config::Metrics& metrics) :
+    scheduler(scheduler),
+    writerId(scheduler.registerWriter([this]() { writeSeedData(); })),
+    metrics(metrics),
+    workers(systemBus->get_io_context(), PASSWORD_KDF_WORKERS,
+            maxQueuedPasswordChanges)
 {
-    // unused today; ABI kept to match main.cpp
-    (void)objectServer;
-    (void)systemBus;
-
     lg2::debug("BIOS config password is running");
     try
     {
         fs::path biosDir(persistPath);
         fs::create_directories(biosDir);
         seedFile = biosDir / biosSeedFile;
+        storeFile = biosDir / biosPasswordStoreFile;
     }
     catch (const fs::filesystem_error& e)
     {
         lg2::error("Failed to parse JSON file: {ERROR}", "ERROR", e);
         throw InternalFailure();
     }
+
+    // Reads the seed data at startup, refreshing the store if it is stale
+    loadSeedData();
+
+    // Calibrated on a worker, new passwords keep the cost of the hash they
+    // replace until it is done
+    std::string_view kdf = PASSWORD_KDF;
+    if (kdf != "stored")
+    {
+        calibrateKdf(std::string(kdf));
+    }
+
+    iface = objectServer.add_interface(objectPathPwd, passwordInterface);
+    iface->register_property("PasswordInitialized", false,
+                             sdbusplus::asio::PropertyPermission::readWrite);
+    iface->register_method(
+        "ChangePassword",
+        [this](boost::asio::yield_context yield, sdbusplus::message_t& msg,
+               std::string userName, std::string currentPassword,
+               std::string newPassword) {
+            changePassword(std::move(yield), msg.get_sender(),
+                           std::move(userName), std::move(currentPassword),
+                           std::move(newPassword));
+        });
+    iface->initialize();
 }
 
 } // namespace bios_config_pwd
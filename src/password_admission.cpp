@@ -0,0 +1,134 @@
+#include "password_admission.hpp"
+
+#include <algorithm>
+
+namespace bios_config_pwd
+{
+
+/** @brief Failures allowed before the first lockout */
+constexpr uint32_t freeFailures = 3;
+
+/** @brief First and longest lockout */
+constexpr auto minLockout = std::chrono::seconds(1);
+constexpr auto maxLockout = std::chrono::minutes(5);
+
+/** @brief Number of keys tracked before the fresh ones are forgotten */
+constexpr size_t maxTrackedKeys = 256;
+
+AdmissionControl::State& AdmissionControl::state(States& states,
+                                                 const Limits& limits,
+                                                 const std::string& key,
+                                                 Clock::time_point now)
+{
+    auto iter = states.find(key);
+    if (iter == states.end())
+    {
+        prune(states, limits, now);
+        iter = states.emplace(key, State{limits.burst, now, 0, {}}).first;
+    }
+    return iter->second;
+}
+
+void AdmissionControl::refill(State& state, const Limits& limits,
+                              Clock::time_point now)
+{
+    if (now <= state.refilled)
+    {
+        return;
+    }
+
+    std::chrono::duration<double> elapsed = now - state.refilled;
+    std::chrono::duration<double> perToken = limits.refill;
+    state.tokens =
+        std::min(limits.burst, state.tokens + elapsed / perToken);
+    state.refilled = now;
+}
+
+void AdmissionControl::lockOut(State& state, Clock::time_point now)
+{
+    state.failures++;
+    if (state.failures <= freeFailures)
+    {
+        return;
+    }
+
+    // Doubles with every failure past the free ones
+    auto shift = std::min<uint32_t>(state.failures - freeFailures - 1, 16);
+    Clock::duration lockout = std::min<Clock::duration>(
+        minLockout * (uint64_t{1} << shift), maxLockout);
+    state.lockedUntil = now + lockout;
+}
+
+void AdmissionControl::prune(States& states, const Limits& limits,
+                             Clock::time_point now)
+{
+    if (states.size() <= maxTrackedKeys)
+    {
+        return;
+    }
+
+    for (auto iter = states.begin(); iter != states.end();)
+    {
+        auto& state = iter->second;
+        refill(state, limits, now);
+        if (state.tokens >= limits.burst && state.failures == 0)
+        {
+            iter = states.erase(iter);
+        }
+        else
+        {
+            ++iter;
+        }
+    }
+}
+
+AdmissionControl::Decision AdmissionControl::admit(const std::string& caller,
+                                                   const std::string& target,
+                                                   Clock::time_point now)
+{
+    auto& callerState = state(callers, callerLimits, caller, now);
+    auto& targetState = state(targets, targetLimits, target, now);
+
+    if (callerState.lockedUntil > now || targetState.lockedUntil > now)
+    {
+        return Decision::lockedOut;
+    }
+
+    refill(callerState, callerLimits, now);
+    refill(targetState, targetLimits, now);
+    if (callerState.tokens < 1 || targetState.tokens < 1)
+    {
+        return Decision::rateLimited;
+    }
+
+    callerState.tokens -= 1;
+    targetState.tokens -= 1;
+    return Decision::admitted;
+}
+
+void AdmissionControl::recordFailure(const std::string& caller,
+                                     const std::string& target,
+                                     Clock::time_point now)
+{
+    lockOut(state(callers, callerLimits, caller, now), now);
+    lockOut(state(targets, targetLimits, target, now), now);
+}
+
+void AdmissionControl::clearFailures(States& states, const std::string& key)
+{
+    auto iter = states.find(key);
+    if (iter != states.end())
+    {
+        iter->second.failures = 0;
+        iter->second.lockedUntil = {};
+    }
+}
+
+void AdmissionControl::recordSuccess(const std::string& caller,
+                                     const std::string& target)
+{
+    clearFailures(callers, caller);
+    clearFailures(targets, target);
+}
+
+} // namespace bios_config_pwd
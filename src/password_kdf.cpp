@@ -0,0 +1,176 @@
+#include "password_kdf.hpp"
+
+#include <openssl/evp.h>
+#include <openssl/sha.h>
+
+#include <phosphor-logging/lg2.hpp>
+
+#include <algorithm>
+#include <array>
+#include <optional>
+
+namespace bios_config_pwd
+{
+
+/** @brief Digest of a PBKDF2 algorithm, nullptr if it is not one.
+ */
+static const EVP_MD* pbkdf2Digest(const std::string& algorithm)
+{
+    if (algorithm == "SHA256")
+    {
+        return EVP_sha256();
+    }
+    if (algorithm == "SHA384")
+    {
+        return EVP_sha384();
+    }
+    if (algorithm == "SHA512")
+    {
+        return EVP_sha512();
+    }
+    return nullptr;
+}
+
+/** @brief Length of the scrypt hashes */
+constexpr size_t scryptHashLength = 32;
+
+/** @brief Smallest scrypt N picked by the calibration */
+constexpr uint64_t minScryptCost = 1024;
+
+uint32_t defaultIterations(const std::string& algorithm)
+{
+    return (algorithm == "SCRYPT") ? scryptParallelism : iterValue;
+}
+
+size_t hashLength(const std::string& algorithm)
+{
+    if (const auto* digest = pbkdf2Digest(algorithm))
+    {
+        return EVP_MD_size(digest);
+    }
+    if (algorithm == "SCRYPT")
+    {
+        return scryptHashLength;
+    }
+    return 0;
+}
+
+bool deriveKey(const KdfParams& params, const std::string& password,
+               std::span<const uint8_t> seed, std::span<uint8_t> hash)
+{
+    if (hash.size() < hashLength(params.algorithm) || params.iterations == 0)
+    {
+        return false;
+    }
+
+    if (const auto* digest = pbkdf2Digest(params.algorithm))
+    {
+        // A larger count would turn negative
+        if (params.iterations > maxIterations)
+        {
+            return false;
+        }
+        return PKCS5_PBKDF2_HMAC(password.c_str(), password.length() + 1,
+                                 seed.data(), seed.size(),
+                                 static_cast<int>(params.iterations), digest,
+                                 EVP_MD_size(digest), hash.data()) == 1;
+    }
+
+    if (params.algorithm == "SCRYPT")
+    {
+        // N must be a power of two
+        if (params.memoryCost < 2 ||
+            (params.memoryCost & (params.memoryCost - 1)) != 0)
+        {
+            return false;
+        }
+        return EVP_PBE_scrypt(password.c_str(), password.length() + 1,
+                              seed.data(), seed.size(), params.memoryCost,
+                              scryptBlockSize, params.iterations,
+                              maxScryptMemory, hash.data(),
+                              scryptHashLength) == 1;
+    }
+
+    return false;
+}
+
+/** @brief Memory a scrypt derivation takes, as OpenSSL counts it against
+ *         maxScryptMemory.
+ */
+static constexpr uint64_t scryptMemory(uint64_t cost, uint64_t parallelism)
+{
+    return 128 * scryptBlockSize * (cost + 2 + parallelism);
+}
+
+/** @brief Time one derivation.
+ *
+ *  @return The time taken, nullopt if the derivation failed.
+ */
+static std::optional<std::chrono::nanoseconds>
+    timeDerivation(const KdfParams& params)
+{
+    std::array<uint8_t, 32> seed{};
+    std::array<uint8_t, 64> hash{};
+    auto start = std::chrono::steady_clock::now();
+    if (!deriveKey(params, "calibration", seed, hash))
+    {
+        lg2::error("Failed to calibrate the {ALGO} key derivation", "ALGO",
+                   params.algorithm);
+        return std::nullopt;
+    }
+    return std::chrono::steady_clock::now() - start;
+}
+
+KdfParams calibrate(const std::string& algorithm,
+                    std::chrono::milliseconds budget)
+{
+    KdfParams params{algorithm, iterValue, 0};
+
+    if (algorithm == "SCRYPT")
+    {
+        // The cost doubles with N, double it while the next one still fits.
+        // A derivation that failed does not fit either.
+        params.iterations = scryptParallelism;
+        params.memoryCost = minScryptCost;
+        auto elapsed = timeDerivation(params);
+        while (elapsed && *elapsed * 2 <= budget &&
+               scryptMemory(params.memoryCost * 2, params.iterations) <=
+                   maxScryptMemory)
+        {
+            params.memoryCost *= 2;
+            elapsed = timeDerivation(params);
+        }
+        if ((!elapsed || *elapsed > budget) &&
+            params.memoryCost > minScryptCost)
+        {
+            params.memoryCost /= 2;
+        }
+        return params;
+    }
+
+    // PBKDF2 grows linearly with the iterations: time enough of them to be
+    // well above the clock resolution, then scale to the budget
+    constexpr auto minSample = std::chrono::milliseconds(10);
+    uint32_t probe = iterValue;
+    auto elapsed = timeDerivation({algorithm, probe, 0});
+    while (elapsed && *elapsed < minSample && probe <= maxIterations / 2)
+    {
+        probe *= 2;
+        elapsed = timeDerivation({algorithm, probe, 0});
+    }
+    if (!elapsed)
+    {
+        return params;
+    }
+
+    // In floating point, a long budget would overflow the product
+    double fitting =
+        probe * (std::chrono::duration<double>(budget) /
+                 std::max(*elapsed, std::chrono::nanoseconds(1)));
+    params.iterations = static_cast<uint32_t>(
+        std::clamp<double>(fitting, iterValue, maxIterations));
+    params.iterations -= params.iterations % iterValue;
+    return params;
+}
+
+} // namespace bios_config_pwd
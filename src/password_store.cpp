@@ -0,0 +1,220 @@
+#include "password_store.hpp"
+
+#include <boost/crc.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <stdexcept>
+#include <type_traits>
+
+namespace bios_config_pwd::password_store
+{
+
+struct KdfRecord
+{
+    std::array<char, maxAlgorithmLength + 1> algorithm;
+    uint32_t iterations;
+    uint32_t reserved;
+    uint64_t memoryCost;
+};
+
+struct Record
+{
+    std::array<char, 8> magic;
+    uint32_t version;
+    uint32_t flags;
+    Seed seed;
+    Hash userPwdHash;
+    Hash adminPwdHash;
+    KdfRecord userKdf;
+    KdfRecord adminKdf;
+    uint32_t checksum;
+    uint32_t reserved;
+};
+
+static_assert(std::is_trivially_copyable_v<Record>);
+static_assert(sizeof(Record) == 248, "the record layout is persisted");
+
+/** @brief Flags of a record */
+constexpr uint32_t adminPwdChanged = 1U << 0;
+constexpr uint32_t userPwdChanged = 1U << 1;
+
+static uint32_t checksum(const Record& record)
+{
+    boost::crc_32_type crc;
+    crc.process_bytes(&record, offsetof(Record, checksum));
+    return crc.checksum();
+}
+
+static KdfRecord kdfRecord(const KdfParams& params)
+{
+    // fromJson and the calibration never produce longer names
+    KdfRecord record{};
+    std::memcpy(record.algorithm.data(), params.algorithm.data(),
+                std::min(params.algorithm.size(), maxAlgorithmLength));
+    record.iterations = params.iterations;
+    record.memoryCost = params.memoryCost;
+    return record;
+}
+
+static KdfParams kdfParams(const KdfRecord& record)
+{
+    return {std::string(record.algorithm.data(),
+                        strnlen(record.algorithm.data(),
+                                record.algorithm.size())),
+            record.iterations, record.memoryCost};
+}
+
+std::string encode(const PasswordRecord& passwords)
+{
+    const auto& params = passwords.params;
+
+    Record record{};
+    record.magic = magic;
+    record.version = version;
+    record.flags = (passwords.isAdminPwdChanged ? adminPwdChanged : 0) |
+                   (passwords.isUserPwdChanged ? userPwdChanged : 0);
+    record.seed = params.seed;
+    record.userPwdHash = params.userPwdHash;
+    record.adminPwdHash = params.adminPwdHash;
+    record.userKdf = kdfRecord(params.userKdf);
+    record.adminKdf = kdfRecord(params.adminKdf);
+    record.checksum = checksum(record);
+
+    return {reinterpret_cast<const char*>(&record), sizeof(record)};
+}
+
+PasswordRecord decode(std::string_view data)
+{
+    Record record{};
+    if (data.size() != sizeof(record))
+    {
+        throw std::runtime_error("Password store has the wrong size");
+    }
+    std::memcpy(&record, data.data(), sizeof(record));
+
+    if (record.magic != magic)
+    {
+        throw std::runtime_error("Not a password store");
+    }
+    if (record.version != version)
+    {
+        throw std::runtime_error("Unsupported password store version " +
+                                 std::to_string(record.version));
+    }
+    if (record.checksum != checksum(record))
+    {
+        throw std::runtime_error("Password store checksum mismatch");
+    }
+
+    PasswordRecord passwords;
+    passwords.params = {record.userPwdHash, record.adminPwdHash, record.seed,
+                        kdfParams(record.userKdf), kdfParams(record.adminKdf)};
+    passwords.isAdminPwdChanged = (record.flags & adminPwdChanged) != 0;
+    passwords.isUserPwdChanged = (record.flags & userPwdChanged) != 0;
+    return passwords;
+}
+
+/** @brief Read key derivation parameters, the ones missing are taken from
+ *         the defaults. Iterations of another algorithm than the defaults'
+ *         mean something else, the algorithm's own default replaces them.
+ */
+static KdfParams parseKdf(const nlohmann::json& json,
+                          const KdfParams& defaults)
+{
+    KdfParams params{json.value("HashAlgo", defaults.algorithm),
+                     defaults.iterations,
+                     json.value("MemoryCost", defaults.memoryCost)};
+    if (params.algorithm.size() > maxAlgorithmLength)
+    {
+        throw std::runtime_error("Hash algorithm name is too long");
+    }
+    if (json.contains("Iterations"))
+    {
+        params.iterations = json.at("Iterations").get<uint32_t>();
+    }
+    else if (params.algorithm != defaults.algorithm)
+    {
+        params.iterations = defaultIterations(params.algorithm);
+    }
+    if (params.iterations > maxIterations)
+    {
+        throw std::runtime_error("Hash iteration count is too large");
+    }
+    return params;
+}
+
+/** @brief Key derivation of the hashes that do not have their own.
+ */
+static KdfParams recordKdf(const nlohmann::json& document)
+{
+    std::string algorithm = document.at("HashAlgo");
+    return parseKdf(document, {algorithm, defaultIterations(algorithm), 0});
+}
+
+PasswordRecord fromJson(const nlohmann::json& document)
+{
+    PasswordRecord passwords;
+    if (document.is_null())
+    {
+        return passwords;
+    }
+
+    auto& params = passwords.params;
+    params.userPwdHash = document.at("UserPwdHash");
+    params.adminPwdHash = document.at("AdminPwdHash");
+    params.seed = document.at("Seed");
+
+    // Hashes without their own parameters use the ones of the record,
+    // iterValue PBKDF2 iterations or a scrypt p of 1 unless it says
+    // otherwise
+    auto kdf = recordKdf(document);
+    params.userKdf = document.contains("UserPwdKdf")
+                         ? parseKdf(document.at("UserPwdKdf"), kdf)
+                         : kdf;
+    params.adminKdf = document.contains("AdminPwdKdf")
+                          ? parseKdf(document.at("AdminPwdKdf"), kdf)
+                          : kdf;
+
+    passwords.isAdminPwdChanged = document.value("IsAdminPwdChanged", false);
+    passwords.isUserPwdChanged = document.value("IsUserPwdChanged", false);
+    return passwords;
+}
+
+/** @brief Write the key derivation of a hash, unless it is the one of the
+ *         document.
+ */
+static void kdfToJson(const KdfParams& params, const KdfParams& defaults,
+                      const char* key, nlohmann::json& document)
+{
+    if (params == defaults)
+    {
+        document.erase(key);
+        return;
+    }
+    document[key] = {{"HashAlgo", params.algorithm},
+                     {"Iterations", params.iterations},
+                     {"MemoryCost", params.memoryCost}};
+}
+
+void toJson(const PasswordRecord& passwords, nlohmann::json& document)
+{
+    const auto& params = passwords.params;
+    document["UserPwdHash"] = params.userPwdHash;
+    document["AdminPwdHash"] = params.adminPwdHash;
+    document["Seed"] = params.seed;
+    if (!document.contains("HashAlgo"))
+    {
+        document["HashAlgo"] = params.userKdf.algorithm;
+    }
+
+    auto kdf = recordKdf(document);
+    kdfToJson(params.userKdf, kdf, "UserPwdKdf", document);
+    kdfToJson(params.adminKdf, kdf, "AdminPwdKdf", document);
+
+    document["IsAdminPwdChanged"] = passwords.isAdminPwdChanged;
+    document["IsUserPwdChanged"] = passwords.isUserPwdChanged;
+}
+
+} // namespace bios_config_pwd::password_store
@@ -0,0 +1,111 @@
+#include "persist_scheduler.hpp"
+
+#include <phosphor-logging/lg2.hpp>
+
+namespace bios_config
+{
+
+PersistScheduler::PersistScheduler(
+    boost::asio::io_context& io, sdbusplus::asio::object_server& objectServer,
+    std::chrono::milliseconds window, size_t maxPending, Metrics& metrics) :
+    timer(io), window(window), maxPending(maxPending), metrics(metrics),
+    fileWriter(io, metrics)
+{
+    iface = objectServer.add_interface(persistObjectPath, persistInterface);
+    iface->register_property_r<uint64_t>(
+        "CoalescedWrites", 0, sdbusplus::vtable::property_::none,
+        [this](const auto&) { return coalesced; });
+    iface->register_property_r<uint64_t>(
+        "PhysicalWrites", 0, sdbusplus::vtable::property_::none,
+        [this](const auto&) { return physical; });
+    iface->register_property_r<uint64_t>(
+        "WindowMilliseconds", 0, sdbusplus::vtable::property_::const_,
+        [this](const auto&) {
+            return static_cast<uint64_t>(this->window.count());
+        });
+    iface->register_property_r<uint64_t>(
+        "MaxPendingChanges", 0, sdbusplus::vtable::property_::const_,
+        [this](const auto&) {
+            return static_cast<uint64_t>(this->maxPending);
+        });
+    iface->initialize();
+}
+
+PersistScheduler::WriterId PersistScheduler::registerWriter(Writer writer)
+{
+    slots.emplace_back(std::move(writer));
+    return slots.size() - 1;
+}
+
+void PersistScheduler::markDirty(WriterId id)
+{
+    auto& slot = slots.at(id);
+    if (slot.dirty)
+    {
+        coalesced++;
+    }
+    slot.dirty = true;
+
+    if (++pendingChanges >= maxPending || window.count() == 0)
+    {
+        flush();
+        return;
+    }
+
+    if (armed)
+    {
+        return;
+    }
+
+    armed = true;
+    timer.expires_after(window);
+    timer.async_wait([this](const boost::system::error_code& ec) {
+        if (ec == boost::asio::error::operation_aborted)
+        {
+            return;
+        }
+        armed = false;
+        flush();
+    });
+}
+
+void PersistScheduler::flush()
+{
+    if (armed)
+    {
+        timer.cancel();
+        armed = false;
+    }
+
+    pendingChanges = 0;
+    for (auto& slot : slots)
+    {
+        if (!slot.dirty)
+        {
+            continue;
+        }
+
+        // Clear the flag first so a writer that changes state again is
+        // picked up by the next commit.
+        slot.dirty = false;
+        auto start = std::chrono::steady_clock::now();
+        try
+        {
+            slot.writer();
+        }
+        catch (const std::exception& e)
+        {
+            lg2::error("Failed to persist state: {ERROR}", "ERROR", e);
+        }
+        metrics.recordPersist(std::chrono::steady_clock::now() - start);
+        physical++;
+    }
+}
+
+void PersistScheduler::sync()
+{
+    flush();
+    fileWriter.drain();
+}
+
+} // namespace bios_config
@@ -1,8 +1,12 @@
 #include "secureboot.hpp"
 
+#include "compression.hpp"
+#include "file_writer.hpp"
+
 #include <cereal/archives/binary.hpp>
 
 #include <fstream>
+#include <sstream>
 
 // Register class version with Cereal
 CEREAL_CLASS_VERSION(bios_config::SecureBoot, 0)
@@ -12,10 +16,13 @@ namespace bios_config
 
 SecureBoot::SecureBoot(sdbusplus::asio::object_server& objectServer,
                        std::shared_ptr<sdbusplus::asio::connection>& systemBus,
-                       std::string persistPath) :
+                       std::string persistPath, PersistScheduler& scheduler,
+                       Metrics& metrics) :
     sdbusplus::xyz::openbmc_project::BIOSConfig::server::SecureBoot(
         *systemBus, secureBootObjectPath),
-    objServer(objectServer), systemBus(systemBus)
+    objServer(objectServer), systemBus(systemBus), scheduler(scheduler),
+    writerId(scheduler.registerWriter([this]() { serialize(); })),
+    metrics(metrics)
 {
     fs::path secureBootDir(persistPath);
     fs::create_directories(secureBootDir);
@@ -26,22 +33,25 @@ SecureBoot::SecureBoot(sdbusplus::asio::object_server& objectServer,
 SecureBootBase::CurrentBootType SecureBoot::currentBoot(
     SecureBootBase::CurrentBootType value)
 {
+    auto timer = metrics.time(Metrics::Handler::currentBoot);
     auto ret = SecureBootBase::currentBoot(value);
-    serialize();
+    scheduler.markDirty(writerId);
     return ret;
 }
 
 bool SecureBoot::pendingEnable(bool value)
 {
+    auto timer = metrics.time(Metrics::Handler::pendingEnable);
     auto ret = SecureBootBase::pendingEnable(value);
-    serialize();
+    scheduler.markDirty(writerId);
     return ret;
 }
 
 SecureBootBase::ModeType SecureBoot::mode(SecureBootBase::ModeType value)
 {
+    auto timer = metrics.time(Metrics::Handler::mode);
     auto ret = SecureBootBase::mode(value);
-    serialize();
+    scheduler.markDirty(writerId);
     return ret;
 }
 
@@ -50,10 +60,13 @@ void SecureBoot::serialize()
     try
     {
         std::filesystem::create_directories(secureBootFile.parent_path());
-        std::ofstream os(secureBootFile.c_str(),
-                         std::ios::out | std::ios::binary);
-        cereal::BinaryOutputArchive oarchive(os);
-        oarchive(*this);
+        std::ostringstream os(std::ios::out | std::ios::binary);
+        {
+            cereal::BinaryOutputArchive oarchive(os);
+            oarchive(*this);
+        }
+        scheduler.files().replace(secureBootFile,
+                                  compression::compress(os.view()));
     }
     catch (const std::exception& e)
     {
@@ -67,8 +80,20 @@ bool SecureBoot::deserialize()
     {
         if (std::filesystem::exists(secureBootFile))
         {
-            std::ifstream is(secureBootFile.c_str(),
-                             std::ios::in | std::ios::binary);
+            std::ifstream file(secureBootFile.c_str(),
+                               std::ios::in | std::ios::binary);
+            std::ostringstream content(std::ios::out | std::ios::binary);
+            content << file.rdbuf();
+
+            // Files written without compression hold the archive as it is
+            std::string data = std::move(content).str();
+            if (compression::isCompressed(data))
+            {
+                data = compression::decompress(data);
+            }
+
+            std::istringstream is(std::move(data),
+                                  std::ios::in | std::ios::binary);
             cereal::BinaryInputArchive iarchive(is);
             iarchive(*this);
             return true;
@@ -78,6 +103,7 @@ bool SecureBoot::deserialize()
     catch (const std::exception& e)
     {
         lg2::error("Failed to deserialize SecureBoot: {ERROR}", "ERROR", e);
+        FileWriter::setAside(secureBootFile);
         return false;
     }
 }
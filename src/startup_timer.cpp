@@ -0,0 +1,61 @@
+#include "startup_timer.hpp"
+
+#include <systemd/sd-daemon.h>
+
+#include <phosphor-logging/lg2.hpp>
+
+#include <string>
+
+namespace bios_config
+{
+
+StartupTimer::StartupTimer() : start(Clock::now()), last(start) {}
+
+void StartupTimer::end(Phase phase)
+{
+    auto now = Clock::now();
+    durations[static_cast<uint8_t>(phase)] =
+        std::chrono::duration_cast<std::chrono::microseconds>(now - last);
+    last = now;
+}
+
+void StartupTimer::ready(sdbusplus::asio::object_server& objectServer)
+{
+    total = std::chrono::duration_cast<std::chrono::microseconds>(last - start);
+
+    lg2::info("Startup completed in {TOTAL_US} us", "TOTAL_US", total.count(),
+              "REQUEST_NAME_US", duration(Phase::requestName), "MANAGER_US",
+              duration(Phase::manager), "PASSWORD_US",
+              duration(Phase::password), "SECUREBOOT_US",
+              duration(Phase::secureBoot));
+
+    iface = objectServer.add_interface(startupObjectPath, startupInterface);
+    iface->register_property_r<uint64_t>(
+        "TotalMicroseconds", 0, sdbusplus::vtable::property_::const_,
+        [this](const auto&) { return static_cast<uint64_t>(total.count()); });
+    iface->register_property_r<uint64_t>(
+        "RequestNameMicroseconds", 0, sdbusplus::vtable::property_::const_,
+        [this](const auto&) { return duration(Phase::requestName); });
+    iface->register_property_r<uint64_t>(
+        "ManagerMicroseconds", 0, sdbusplus::vtable::property_::const_,
+        [this](const auto&) { return duration(Phase::manager); });
+    iface->register_property_r<uint64_t>(
+        "PasswordMicroseconds", 0, sdbusplus::vtable::property_::const_,
+        [this](const auto&) { return duration(Phase::password); });
+    iface->register_property_r<uint64_t>(
+        "SecureBootMicroseconds", 0, sdbusplus::vtable::property_::const_,
+        [this](const auto&) { return duration(Phase::secureBoot); });
+    iface->initialize();
+
+    // The state is loaded and every object is on the bus, services ordered
+    // after this one can start.
+    auto status = "READY=1\nSTATUS=Started in " +
+                  std::to_string(total.count() / 1000) + " ms";
+    int rc = sd_notify(0, status.c_str());
+    if (rc < 0)
+    {
+        lg2::error("Failed to notify systemd of readiness: {RC}", "RC", rc);
+    }
+}
+
+} // namespace bios_config
@@ -0,0 +1,40 @@
+#include "string_pool.hpp"
+
+namespace bios_config
+{
+
+StringId StringPool::intern(std::string_view value)
+{
+    auto iter = index.find(value);
+    if (iter != index.end())
+    {
+        return iter->second;
+    }
+
+    auto id = static_cast<StringId>(strings.size());
+    const auto& stored = strings.emplace_back(value);
+    index.emplace(stored, id);
+    totalCharacters += stored.size();
+
+    return id;
+}
+
+std::optional<StringId> StringPool::find(std::string_view value) const
+{
+    auto iter = index.find(value);
+    if (iter == index.end())
+    {
+        return std::nullopt;
+    }
+
+    return iter->second;
+}
+
+void StringPool::clear()
+{
+    index.clear();
+    strings.clear();
+    totalCharacters = 0;
+}
+
+} // namespace bios_config
@@ -0,0 +1,141 @@
+#include "worker_pool.hpp"
+
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <boost/asio/buffer.hpp>
+#include <phosphor-logging/lg2.hpp>
+
+#include <cerrno>
+
+namespace bios_config
+{
+
+WorkerPool::WorkerPool(boost::asio::io_context& io, size_t threads,
+                       size_t maxQueued) :
+    io(io), maxQueued(maxQueued),
+    event(io, ::eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK)),
+    eventFd(event.native_handle())
+{
+    waitCompletions();
+    workers.reserve(threads);
+    for (size_t i = 0; i < threads; i++)
+    {
+        workers.emplace_back([this]() { work(); });
+    }
+}
+
+WorkerPool::~WorkerPool()
+{
+    {
+        std::lock_guard lock(mutex);
+        stopping = true;
+        queued.clear();
+    }
+    wakeWorker.notify_all();
+    for (auto& worker : workers)
+    {
+        worker.join();
+    }
+}
+
+bool WorkerPool::submit(Job job, Done done)
+{
+    {
+        std::lock_guard lock(mutex);
+        if (queued.size() >= maxQueued)
+        {
+            return false;
+        }
+        queued.push_back({std::move(job), std::move(done)});
+    }
+    wakeWorker.notify_one();
+    return true;
+}
+
+size_t WorkerPool::inFlight() const
+{
+    std::lock_guard lock(mutex);
+    return queued.size() + running;
+}
+
+void WorkerPool::work()
+{
+    std::unique_lock lock(mutex);
+    while (true)
+    {
+        wakeWorker.wait(lock,
+                        [this]() { return stopping || !queued.empty(); });
+        if (stopping)
+        {
+            return;
+        }
+
+        auto task = std::move(queued.front());
+        queued.pop_front();
+        running++;
+        lock.unlock();
+
+        try
+        {
+            task.job();
+        }
+        catch (const std::exception& e)
+        {
+            lg2::error("Worker job failed: {ERROR}", "ERROR", e);
+        }
+        task.job = nullptr;
+
+        lock.lock();
+        running--;
+        completed.push_back(std::move(task.done));
+
+        uint64_t one = 1;
+        if (::write(eventFd, &one, sizeof(one)) < 0)
+        {
+            lg2::error("Failed to signal a completed job: {ERRNO}", "ERRNO",
+                       errno);
+        }
+    }
+}
+
+void WorkerPool::waitCompletions()
+{
+    event.async_read_some(
+        boost::asio::buffer(&eventCount, sizeof(eventCount)),
+        [this](const boost::system::error_code& ec, size_t) {
+            if (ec == boost::asio::error::operation_aborted)
+            {
+                return;
+            }
+            runCompletions();
+            waitCompletions();
+        });
+}
+
+void WorkerPool::runCompletions()
+{
+    std::vector<Done> batch;
+    {
+        std::lock_guard lock(mutex);
+        batch.swap(completed);
+    }
+
+    for (const auto& done : batch)
+    {
+        if (!done)
+        {
+            continue;
+        }
+        try
+        {
+            done();
+        }
+        catch (const std::exception& e)
+        {
+            lg2::error("Failed to complete a worker job: {ERROR}", "ERROR", e);
+        }
+    }
+}
+
+} // namespace bios_config
@@ -0,0 +1,147 @@
+#pragma once
+
+#include "manager.hpp"
+#include "metrics.hpp"
+#include "persist_scheduler.hpp"
+
+#include <sys/socket.h>
+#include <systemd/sd-bus.h>
+
+#include <boost/asio/io_context.hpp>
+#include <sdbusplus/asio/connection.hpp>
+#include <sdbusplus/asio/object_server.hpp>
+
+#include <array>
+#include <chrono>
+#include <filesystem>
+#include <memory>
+#include <stdexcept>
+
+namespace bios_config::test
+{
+
+/** @class PeerBus
+ *
+ *  @brief Connection on a peer-to-peer bus whose other end lives in the test
+ *         process, so that nothing touches the system bus.
+ */
+class PeerBus
+{
+  public:
+    PeerBus()
+    {
+        std::array<int, 2> fds{};
+        if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0,
+                       fds.data()) != 0)
+        {
+            throw std::runtime_error("socketpair failed");
+        }
+
+        sd_id128_t id{};
+        sd_id128_randomize(&id);
+        sd_bus_new(&peer);
+        sd_bus_set_fd(peer, fds[0], fds[0]);
+        sd_bus_set_server(peer, 1, id);
+        sd_bus_start(peer);
+
+        sd_bus* bus = nullptr;
+        sd_bus_new(&bus);
+        sd_bus_set_fd(bus, fds[1], fds[1]);
+        sd_bus_start(bus);
+
+        connection = std::make_shared<sdbusplus::asio::connection>(io, bus);
+        objectServer =
+            std::make_unique<sdbusplus::asio::object_server>(connection);
+        metrics = std::make_unique<Metrics>(*objectServer);
+    }
+
+    ~PeerBus()
+    {
+        metrics.reset();
+        objectServer.reset();
+        connection.reset();
+        sd_bus_flush_close_unref(peer);
+    }
+
+    PeerBus(const PeerBus&) = delete;
+    PeerBus& operator=(const PeerBus&) = delete;
+    PeerBus(PeerBus&&) = delete;
+    PeerBus& operator=(PeerBus&&) = delete;
+
+    /** @brief Deliver the queued signals to the peer and discard them.
+     */
+    void drain()
+    {
+        while (sd_bus_process(connection->get(), nullptr) > 0 ||
+               sd_bus_process(peer, nullptr) > 0)
+        {}
+    }
+
+    boost::asio::io_context io;
+    sd_bus* peer = nullptr;
+    std::shared_ptr<sdbusplus::asio::connection> connection;
+    std::unique_ptr<sdbusplus::asio::object_server> objectServer;
+    std::unique_ptr<Metrics> metrics;
+};
+
+/** @class Daemon
+ *
+ *  @brief Manager persisting to a directory, as the daemon runs it. A new
+ *         Daemon on the same directory is a restart.
+ */
+class Daemon : public PeerBus
+{
+  public:
+    /** @brief Start the Manager.
+     *
+     *  @param[in] persistPath - directory of the persisted files
+     *  @param[in] window - commit window of the persist scheduler, by
+     *                      default long enough that only sync writes
+     */
+    explicit Daemon(const std::filesystem::path& persistPath,
+                    std::chrono::milliseconds window = std::chrono::hours(1)) :
+        persistPath(persistPath)
+    {
+        scheduler = std::make_unique<PersistScheduler>(
+            io, *objectServer, window, maxPending, *metrics);
+        manager = std::make_unique<Manager>(
+            *objectServer, connection, persistPath.string(), *scheduler,
+            *metrics);
+    }
+
+    ~Daemon()
+    {
+        manager.reset();
+        scheduler.reset();
+    }
+
+    Daemon(const Daemon&) = delete;
+    Daemon& operator=(const Daemon&) = delete;
+    Daemon(Daemon&&) = delete;
+    Daemon& operator=(Daemon&&) = delete;
+
+    /** @brief Write out the changes made so far, including the snapshot
+     *         that a failed write asks for, and wait until they are on
+     *         stable storage.
+     */
+    void sync()
+    {
+        scheduler->sync();
+        scheduler->sync();
+        drain();
+    }
+
+    std::filesystem::path biosFile() const
+    {
+        return persistPath / biosPersistFile;
+    }
+
+    std::filesystem::path persistPath;
+    std::unique_ptr<PersistScheduler> scheduler;
+    std::unique_ptr<Manager> manager;
+
+  private:
+    static constexpr size_t maxPending = 256;
+};
+
+} // namespace bios_config::test
@@ -0,0 +1,228 @@
+#include "daemon.hpp"
+#include "xyz/openbmc_project/BIOSConfig/Common/error.hpp"
+#include "xyz/openbmc_project/Common/error.hpp"
+
+#include <unistd.h>
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <tuple>
+#include <variant>
+#include <vector>
+
+namespace bios_config::test
+{
+
+namespace fs = std::filesystem;
+using AttributeType = Manager::AttributeType;
+using BoundType = Manager::BoundType;
+using sdbusplus::xyz::openbmc_project::BIOSConfig::Common::Error::
+    AttributeReadOnly;
+using sdbusplus::xyz::openbmc_project::Common::Error::InvalidArgument;
+
+/** @brief B is hidden while A is 1, C is the upper bound of D.
+ */
+constexpr auto rules = R"([
+    {"Attribute": "B", "Effect": "Hidden", "When": "A", "Equals": 1},
+    {"Attribute": "D", "Effect": "UpperBound", "From": "C"}
+])";
+
+static Manager::BaseTable makeTable()
+{
+    Manager::BaseTable table;
+    for (const auto* name : {"A", "B", "C", "D"})
+    {
+        std::vector<std::tuple<BoundType, std::variant<int64_t, std::string>,
+                               std::string>>
+            options{{BoundType::LowerBound, 0, ""},
+                    {BoundType::UpperBound, 100, ""},
+                    {BoundType::ScalarIncrement, 1, ""}};
+        table.emplace(name, std::make_tuple(AttributeType::Integer, false,
+                                            name, "", "./Test", int64_t{0},
+                                            int64_t{0}, options));
+    }
+    return table;
+}
+
+template <typename Map>
+static std::vector<std::string> names(const Map& map)
+{
+    std::vector<std::string> result;
+    for (const auto& [name, value] : map)
+    {
+        result.emplace_back(name);
+    }
+    return result;
+}
+
+class DependenciesTest : public testing::Test
+{
+  protected:
+    DependenciesTest() :
+        dir(fs::temp_directory_path() /
+            ("biosconfig-dependencies-" + std::to_string(getpid())))
+    {
+        fs::remove_all(dir);
+        Daemon daemon(dir);
+        daemon.manager->baseBIOSTable(makeTable());
+        daemon.manager->setDependencies(rules);
+        daemon.manager->setAttributes({{"B", 5}, {"C", 7}});
+        daemon.manager->setAttribute("A", int64_t{1});
+        daemon.sync();
+    }
+
+    ~DependenciesTest() override
+    {
+        fs::remove_all(dir);
+    }
+
+    /** @brief Check that B is hidden from every read but its state.
+     */
+    static void expectHidden(Manager& manager)
+    {
+        auto state = manager.getAttributeState("B");
+        EXPECT_TRUE(std::get<1>(state));
+
+        EXPECT_THROW(manager.getAttribute("B"), std::exception);
+
+        auto [found, missing] = manager.getAttributes({"A", "B"});
+        EXPECT_EQ(names(found), (std::vector<std::string>{"A"}));
+        EXPECT_EQ(missing, std::vector<std::string>{"B"});
+
+        auto [all, none] = manager.getAttributes({});
+        EXPECT_EQ(names(all), (std::vector<std::string>{"A", "C", "D"}));
+
+        // Pages are filled up past the hidden attribute
+        std::vector<std::string> paged;
+        std::string cursor;
+        do
+        {
+            auto [page, next] = manager.getBaseTablePage(cursor, 1);
+            EXPECT_EQ(page.size(), 1);
+            for (const auto& name : names(page))
+            {
+                paged.emplace_back(name);
+            }
+            cursor = next;
+        } while (!cursor.empty());
+        EXPECT_EQ(paged, (std::vector<std::string>{"A", "C", "D"}));
+
+        auto [pending, next] = manager.getPendingPage("", 10);
+        EXPECT_EQ(names(pending), (std::vector<std::string>{"A", "C"}));
+
+        // Loads the attributes into memory to build the menu
+        auto [submenus, inMenu] = manager.getMenu("./Test");
+        EXPECT_EQ(names(inMenu), (std::vector<std::string>{"A", "C", "D"}));
+    }
+
+    fs::path dir;
+};
+
+TEST_F(DependenciesTest, HiddenAttributeIsLeftOut)
+{
+    // A change loads the attributes from the image into memory
+    Daemon daemon(dir);
+    daemon.manager->setAttribute("C", int64_t{8});
+    expectHidden(*daemon.manager);
+    EXPECT_EQ(std::get<3>(daemon.manager->getAttributeState("D")), 8);
+}
+
+TEST_F(DependenciesTest, HiddenAttributeShowsAgain)
+{
+    Daemon daemon(dir);
+    daemon.manager->setAttribute("A", int64_t{0});
+
+    auto [found, missing] = daemon.manager->getAttributes({});
+    EXPECT_EQ(names(found), (std::vector<std::string>{"A", "B", "C", "D"}));
+    EXPECT_EQ(std::get<2>(daemon.manager->getAttribute("B")),
+              Manager::PendingValue(int64_t{5}));
+    EXPECT_FALSE(std::get<1>(daemon.manager->getAttributeState("B")));
+}
+
+TEST_F(DependenciesTest, StateIsReadFromTheImage)
+{
+    // The first start compacts the journal into the image, the second one
+    // serves the attributes from the mapped image
+    {
+        Daemon daemon(dir);
+    }
+    Daemon daemon(dir);
+
+    auto state = daemon.manager->getAttributeState("D");
+    EXPECT_FALSE(std::get<0>(state));
+    EXPECT_EQ(std::get<2>(state), 0);
+    EXPECT_EQ(std::get<3>(state), 7);
+
+    expectHidden(*daemon.manager);
+}
+
+TEST_F(DependenciesTest, NewRulesApplyToTheImage)
+{
+    {
+        Daemon daemon(dir);
+    }
+    Daemon daemon(dir);
+    daemon.manager->setDependencies("[]");
+    EXPECT_FALSE(std::get<1>(daemon.manager->getAttributeState("B")));
+    EXPECT_EQ(std::get<3>(daemon.manager->getAttributeState("D")), 100);
+
+    auto [found, missing] = daemon.manager->getAttributes({"B"});
+    EXPECT_EQ(names(found), std::vector<std::string>{"B"});
+}
+
+TEST_F(DependenciesTest, ReadOnlyTargetIsRejected)
+{
+    Daemon daemon(dir);
+    EXPECT_THROW(daemon.manager->setAttribute("B", int64_t{6}),
+                 AttributeReadOnly);
+
+    daemon.manager->setDependencies(
+        R"([{"Attribute": "D", "Effect": "ReadOnly", "When": "A",
+             "Equals": 1}])");
+    EXPECT_THROW(daemon.manager->setAttribute("D", int64_t{3}),
+                 AttributeReadOnly);
+    EXPECT_THROW(daemon.manager->setAttributes({{"C", 3}, {"D", 3}}),
+                 AttributeReadOnly);
+    EXPECT_EQ(std::get<int64_t>(std::get<2>(daemon.manager->getAttribute("C"))),
+              7);
+
+    // Changing the source in the same call lifts the rule
+    daemon.manager->setAttributes({{"A", 0}, {"D", 3}});
+    EXPECT_EQ(std::get<int64_t>(std::get<2>(daemon.manager->getAttribute("D"))),
+              3);
+}
+
+TEST_F(DependenciesTest, OutOfBoundValueIsRejected)
+{
+    Daemon daemon(dir);
+    EXPECT_THROW(daemon.manager->setAttribute("D", int64_t{8}),
+                 InvalidArgument);
+    EXPECT_THROW(daemon.manager->setAttributes({{"C", 8}, {"D", 9}}),
+                 InvalidArgument);
+
+    daemon.manager->setAttribute("D", int64_t{7});
+    daemon.manager->setAttributes({{"C", 9}, {"D", 9}});
+    EXPECT_EQ(std::get<3>(daemon.manager->getAttributeState("D")), 9);
+}
+
+TEST_F(DependenciesTest, BoundLeavingPendingValueOutIsRejected)
+{
+    Daemon daemon(dir);
+    daemon.manager->setAttribute("D", int64_t{7});
+
+    EXPECT_THROW(daemon.manager->setAttribute("C", int64_t{6}),
+                 InvalidArgument);
+    EXPECT_EQ(std::get<int64_t>(std::get<2>(daemon.manager->getAttribute("C"))),
+              7);
+    EXPECT_EQ(std::get<3>(daemon.manager->getAttributeState("D")), 7);
+
+    // A bound that is unchanged or wider is fine
+    daemon.manager->setAttribute("C", int64_t{7});
+    daemon.manager->setAttribute("C", int64_t{50});
+    EXPECT_EQ(std::get<3>(daemon.manager->getAttributeState("D")), 50);
+}
+
+} // namespace bios_config::test
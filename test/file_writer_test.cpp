@@ -0,0 +1,156 @@
+#include "daemon.hpp"
+#include "file_writer.hpp"
+
+#include <unistd.h>
+
+#include <gtest/gtest.h>
+
+#include <filesystem>
+#include <fstream>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace bios_config::test
+{
+
+namespace fs = std::filesystem;
+
+class FileWriterTest : public testing::Test
+{
+  protected:
+    FileWriterTest() :
+        dir(fs::temp_directory_path() /
+            ("biosconfig-file-writer-" + std::to_string(getpid()))),
+        file(dir / "data")
+    {
+        fs::remove_all(dir);
+        fs::create_directories(dir);
+        writer = std::make_unique<FileWriter>(bus.io, *bus.metrics);
+    }
+
+    ~FileWriterTest() override
+    {
+        writer.reset();
+        fs::remove_all(dir);
+    }
+
+    /** @brief Content of a file, nullopt if it does not exist.
+     */
+    static std::optional<std::string> content(const fs::path& path)
+    {
+        std::ifstream is(path, std::ios::in | std::ios::binary);
+        if (!is.is_open())
+        {
+            return std::nullopt;
+        }
+        std::ostringstream data;
+        data << is.rdbuf();
+        return data.str();
+    }
+
+    /** @brief Completion recording its result.
+     */
+    FileWriter::Done record()
+    {
+        return [this](bool ok) { results.push_back(ok); };
+    }
+
+    fs::path dir;
+    fs::path file;
+    PeerBus bus;
+    std::unique_ptr<FileWriter> writer;
+    std::vector<bool> results;
+};
+
+TEST_F(FileWriterTest, ReplaceCreatesFile)
+{
+    writer->replace(file, "one", record());
+    writer->drain();
+
+    EXPECT_EQ(results, std::vector<bool>{true});
+    EXPECT_EQ(content(file), "one");
+    EXPECT_FALSE(fs::exists(dir / "data.tmp"));
+}
+
+TEST_F(FileWriterTest, AppendFollowsReplace)
+{
+    writer->replace(file, "one", record());
+    writer->append(file, "two", record());
+    writer->append(file, "three", record());
+    writer->drain();
+
+    EXPECT_EQ(results, (std::vector<bool>{true, true, true}));
+    EXPECT_EQ(content(file), "onetwothree");
+}
+
+TEST_F(FileWriterTest, AppendToMissingFileFails)
+{
+    writer->append(file, "two", record());
+    writer->drain();
+
+    EXPECT_EQ(results, std::vector<bool>{false});
+    EXPECT_FALSE(fs::exists(file));
+}
+
+TEST_F(FileWriterTest, CompletionsRunOnDrain)
+{
+    writer->replace(file, "one", record());
+    EXPECT_TRUE(results.empty());
+
+    writer->drain();
+    EXPECT_EQ(results, std::vector<bool>{true});
+}
+
+TEST_F(FileWriterTest, FailedReplaceRefusesAppends)
+{
+    ASSERT_TRUE(FileWriter::replaceFile(file, "old"));
+
+    // The temporary file cannot be created while a directory has its name
+    fs::create_directory(dir / "data.tmp");
+    writer->replace(file, "new", record());
+    writer->append(file, "record", record());
+    writer->drain();
+
+    // The record belongs to the new content, it must not follow the old one
+    EXPECT_EQ(results, (std::vector<bool>{false, false}));
+    EXPECT_EQ(content(file), "old");
+
+    results.clear();
+    writer->append(file, "record", record());
+    writer->drain();
+    EXPECT_EQ(results, std::vector<bool>{false});
+    EXPECT_EQ(content(file), "old");
+
+    fs::remove(dir / "data.tmp");
+    results.clear();
+    writer->replace(file, "new", record());
+    writer->append(file, "record", record());
+    writer->drain();
+    EXPECT_EQ(results, (std::vector<bool>{true, true}));
+    EXPECT_EQ(content(file), "newrecord");
+}
+
+TEST_F(FileWriterTest, FailedAppendRefusesLaterAppends)
+{
+    writer->append(file, "lost", record());
+    writer->drain();
+    ASSERT_TRUE(FileWriter::replaceFile(file, "old"));
+
+    // The file exists again, but the record before is missing from it
+    writer->append(file, "record", record());
+    writer->drain();
+    EXPECT_EQ(results, (std::vector<bool>{false, false}));
+    EXPECT_EQ(content(file), "old");
+}
+
+TEST_F(FileWriterTest, StaticReplaceAndAppend)
+{
+    EXPECT_FALSE(FileWriter::appendFile(file, "two"));
+    EXPECT_TRUE(FileWriter::replaceFile(file, "one"));
+    EXPECT_TRUE(FileWriter::appendFile(file, "two"));
+    EXPECT_EQ(content(file), "onetwo");
+}
+
+} // namespace bios_config::test
@@ -0,0 +1,330 @@
+#include "compression.hpp"
+#include "daemon.hpp"
+#include "file_writer.hpp"
+
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <gtest/gtest.h>
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <tuple>
+#include <variant>
+#include <vector>
+
+namespace bios_config::test
+{
+
+namespace fs = std::filesystem;
+using AttributeType = Manager::AttributeType;
+using BoundType = Manager::BoundType;
+
+/** @brief Table of two integer settings A and B and an integer T whose
+ *         current value tells which table it is.
+ */
+static Manager::BaseTable makeTable(int64_t step)
+{
+    Manager::BaseTable table;
+    for (const auto* name : {"A", "B", "T"})
+    {
+        std::vector<std::tuple<BoundType, std::variant<int64_t, std::string>,
+                               std::string>>
+            options{{BoundType::LowerBound, 0, ""},
+                    {BoundType::UpperBound, 1000000, ""},
+                    {BoundType::ScalarIncrement, 1, ""}};
+        std::variant<int64_t, std::string> current =
+            (std::string_view(name) == "T") ? step : 0;
+
+        table.emplace(name, std::make_tuple(AttributeType::Integer, false,
+                                            name, "", "./Test", current,
+                                            current, options));
+    }
+    return table;
+}
+
+static int64_t currentValue(Manager& manager, const std::string& name)
+{
+    return std::get<int64_t>(std::get<1>(manager.getAttribute(name)));
+}
+
+static int64_t pendingValue(Manager& manager, const std::string& name)
+{
+    return std::get<int64_t>(std::get<2>(manager.getAttribute(name)));
+}
+
+class JournalTest : public testing::Test
+{
+  protected:
+    JournalTest() :
+        dir(fs::temp_directory_path() /
+            ("biosconfig-journal-" + std::to_string(getpid())))
+    {
+        fs::remove_all(dir);
+        Daemon daemon(dir);
+        daemon.manager->baseBIOSTable(makeTable(0));
+        daemon.sync();
+    }
+
+    ~JournalTest() override
+    {
+        fs::remove_all(dir);
+    }
+
+    /** @brief Set A and B to a value, as one change.
+     */
+    static void setBoth(Daemon& daemon, int64_t value)
+    {
+        daemon.manager->setAttributes({{"A", value}, {"B", value}});
+    }
+
+    fs::path dir;
+};
+
+TEST_F(JournalTest, ReplaysPendingChanges)
+{
+    {
+        Daemon daemon(dir);
+        setBoth(daemon, 1);
+        daemon.sync();
+        daemon.manager->setAttribute("A", int64_t{2});
+        daemon.sync();
+    }
+
+    Daemon daemon(dir);
+    EXPECT_EQ(pendingValue(*daemon.manager, "A"), 2);
+    EXPECT_EQ(pendingValue(*daemon.manager, "B"), 1);
+}
+
+TEST_F(JournalTest, ReplaysTableUpdates)
+{
+    {
+        Daemon daemon(dir);
+        setBoth(daemon, 1);
+        daemon.sync();
+        daemon.manager->baseBIOSTable(makeTable(5));
+        daemon.sync();
+    }
+
+    Daemon daemon(dir);
+    EXPECT_EQ(currentValue(*daemon.manager, "T"), 5);
+    EXPECT_EQ(pendingValue(*daemon.manager, "A"), 1);
+}
+
+TEST_F(JournalTest, TruncatedRecordEndsJournal)
+{
+    fs::path file;
+    {
+        Daemon daemon(dir);
+        file = daemon.biosFile();
+        setBoth(daemon, 1);
+        daemon.sync();
+        setBoth(daemon, 2);
+        daemon.sync();
+    }
+
+    // Power lost while the last record was written
+    fs::resize_file(file, fs::file_size(file) - 1);
+
+    {
+        Daemon daemon(dir);
+        EXPECT_EQ(pendingValue(*daemon.manager, "A"), 1);
+        EXPECT_EQ(pendingValue(*daemon.manager, "B"), 1);
+
+        // Later records do not follow the cut one
+        setBoth(daemon, 3);
+        daemon.sync();
+    }
+
+    Daemon daemon(dir);
+    EXPECT_EQ(pendingValue(*daemon.manager, "A"), 3);
+}
+
+TEST_F(JournalTest, UnknownRecordEndsJournal)
+{
+    fs::path file;
+    {
+        Daemon daemon(dir);
+        file = daemon.biosFile();
+        setBoth(daemon, 1);
+        daemon.sync();
+    }
+
+    {
+        std::ofstream os(file, std::ios::app | std::ios::binary);
+        os.put(static_cast<char>(0xff));
+    }
+
+    {
+        Daemon daemon(dir);
+        EXPECT_EQ(pendingValue(*daemon.manager, "A"), 1);
+        setBoth(daemon, 2);
+        daemon.sync();
+    }
+
+    Daemon daemon(dir);
+    EXPECT_EQ(pendingValue(*daemon.manager, "A"), 2);
+}
+
+TEST_F(JournalTest, FailedSnapshotIsRetried)
+{
+    fs::path file;
+    fs::path tmpFile;
+    {
+        Daemon daemon(dir);
+        file = daemon.biosFile();
+        tmpFile = file;
+        tmpFile += ".tmp";
+
+        // The record cannot be appended, and the snapshot replacing the
+        // file cannot be written while a directory has its temporary name
+        fs::remove(file);
+        fs::create_directory(tmpFile);
+        setBoth(daemon, 1);
+        daemon.sync();
+        EXPECT_FALSE(fs::exists(file));
+
+        // A change made meanwhile waits for the snapshot as well, it is not
+        // appended to a file the snapshot did not replace
+        std::ofstream(file).close();
+        daemon.manager->setAttribute("B", int64_t{2});
+        daemon.sync();
+        EXPECT_EQ(fs::file_size(file), 0);
+
+        fs::remove(tmpFile);
+        daemon.sync();
+    }
+
+    Daemon daemon(dir);
+    EXPECT_EQ(pendingValue(*daemon.manager, "A"), 1);
+    EXPECT_EQ(pendingValue(*daemon.manager, "B"), 2);
+}
+
+TEST_F(JournalTest, UnreadableFileIsSetAside)
+{
+    fs::path file;
+    {
+        Daemon daemon(dir);
+        file = daemon.biosFile();
+    }
+
+    // A container this build cannot read, as if it was compressed with a
+    // dictionary that is not installed
+    std::string data(compression::magic.begin(), compression::magic.end());
+    data.append(64, '\x5a');
+    ASSERT_TRUE(FileWriter::replaceFile(file, data));
+
+    {
+        Daemon daemon(dir);
+        EXPECT_THROW(daemon.manager->getAttribute("A"), std::exception);
+    }
+
+    auto corruptFile = file;
+    corruptFile += ".corrupt";
+    std::ifstream is(corruptFile, std::ios::in | std::ios::binary);
+    std::string kept((std::istreambuf_iterator<char>(is)),
+                     std::istreambuf_iterator<char>());
+    EXPECT_EQ(kept, data);
+}
+
+/** @brief Steps of the crash test. Every tenth step replaces the table
+ *         before changing the settings.
+ */
+static constexpr int64_t tableStep = 10;
+
+/** @brief Run the steps until killed, reporting every step on stable
+ *         storage on the pipe.
+ */
+[[noreturn]] static void runSteps(const fs::path& dir, int reportFd)
+{
+    Daemon daemon(dir, std::chrono::milliseconds(0));
+    for (int64_t step = 1;; step++)
+    {
+        if (step % tableStep == 0)
+        {
+            daemon.manager->baseBIOSTable(makeTable(step));
+        }
+        daemon.manager->setAttributes({{"A", step}, {"B", step}});
+        daemon.sync();
+
+        if (::write(reportFd, &step, sizeof(step)) != sizeof(step))
+        {
+            _exit(1);
+        }
+    }
+}
+
+TEST_F(JournalTest, RecoversFromKillAtRandomPoints)
+{
+    std::random_device seed;
+    std::mt19937 random(seed());
+    std::uniform_int_distribution<int> delay(0, 50);
+
+    for (int run = 0; run < 25; run++)
+    {
+        fs::remove_all(dir);
+        {
+            Daemon daemon(dir);
+            daemon.manager->baseBIOSTable(makeTable(0));
+            daemon.sync();
+        }
+
+        std::array<int, 2> fds{};
+        ASSERT_EQ(pipe(fds.data()), 0);
+
+        // No Daemon is alive here, the child starts without other threads
+        pid_t child = fork();
+        ASSERT_NE(child, -1);
+        if (child == 0)
+        {
+            ::close(fds[0]);
+            runSteps(dir, fds[1]);
+        }
+        ::close(fds[1]);
+
+        auto killAfter = std::chrono::milliseconds(delay(random));
+        SCOPED_TRACE("run " + std::to_string(run) + " killed after " +
+                     std::to_string(killAfter.count()) + " ms");
+        std::this_thread::sleep_for(killAfter);
+        ::kill(child, SIGKILL);
+        int status = 0;
+        ASSERT_EQ(waitpid(child, &status, 0), child);
+
+        int64_t durable = 0;
+        int64_t step = 0;
+        while (::read(fds[0], &step, sizeof(step)) == sizeof(step))
+        {
+            durable = step;
+        }
+        ::close(fds[0]);
+
+        Daemon daemon(dir);
+        int64_t a = pendingValue(*daemon.manager, "A");
+        int64_t t = currentValue(*daemon.manager, "T");
+
+        // A change is all there or not at all, nothing reported is lost,
+        // at most the step in progress is there besides
+        EXPECT_EQ(pendingValue(*daemon.manager, "B"), a);
+        EXPECT_GE(a, durable);
+        EXPECT_LE(a, durable + 1);
+
+        // The table replaced before the settings of a step is there if they
+        // are, and may be there without them
+        if ((a + 1) % tableStep == 0 && t == a + 1)
+        {
+            continue;
+        }
+        EXPECT_EQ(t, a / tableStep * tableStep);
+    }
+}
+
+} // namespace bios_config::test
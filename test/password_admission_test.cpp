@@ -0,0 +1,68 @@
+#include "password_admission.hpp"
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <string>
+
+namespace bios_config_pwd::test
+{
+
+using Decision = AdmissionControl::Decision;
+
+constexpr AdmissionControl::Limits limits{2, std::chrono::seconds(1)};
+
+TEST(PasswordAdmissionTest, TargetBucketIsSharedByCallers)
+{
+    AdmissionControl admission(limits, limits);
+    auto now = AdmissionControl::Clock::now();
+
+    EXPECT_EQ(admission.admit(":1.1", "admin", now), Decision::admitted);
+    EXPECT_EQ(admission.admit(":1.2", "admin", now), Decision::admitted);
+    EXPECT_EQ(admission.admit(":1.3", "admin", now), Decision::rateLimited);
+    EXPECT_EQ(admission.admit(":1.3", "user", now), Decision::admitted);
+
+    now += std::chrono::seconds(1);
+    EXPECT_EQ(admission.admit(":1.3", "admin", now), Decision::admitted);
+}
+
+TEST(PasswordAdmissionTest, FailuresLockOut)
+{
+    AdmissionControl admission({100, std::chrono::seconds(1)},
+                               {100, std::chrono::seconds(1)});
+    auto now = AdmissionControl::Clock::now();
+
+    for (int i = 0; i < 4; i++)
+    {
+        admission.recordFailure(":1.1", "admin", now);
+    }
+    EXPECT_EQ(admission.admit(":1.2", "admin", now), Decision::lockedOut);
+    EXPECT_EQ(admission.admit(":1.2", "user", now), Decision::admitted);
+
+    admission.recordSuccess(":1.1", "admin");
+    EXPECT_EQ(admission.admit(":1.2", "admin", now), Decision::admitted);
+}
+
+TEST(PasswordAdmissionTest, PruneKeepsFailures)
+{
+    AdmissionControl admission(limits, limits);
+    auto now = AdmissionControl::Clock::now();
+
+    // Failures below the lockout threshold are not locked out yet
+    admission.recordFailure(":1.1", "user", now);
+    admission.recordFailure(":1.1", "user", now);
+    admission.recordFailure(":1.1", "user", now);
+
+    // Enough fresh callers to prune the tracked ones
+    for (int i = 2; i < 1000; i++)
+    {
+        admission.admit(":1." + std::to_string(i), "admin", now);
+        now += std::chrono::seconds(1);
+    }
+
+    // The failures were kept, the next one locks the caller out
+    admission.recordFailure(":1.1", "admin", now);
+    EXPECT_EQ(admission.admit(":1.1", "admin", now), Decision::lockedOut);
+}
+
+} // namespace bios_config_pwd::test
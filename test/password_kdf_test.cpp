@@ -0,0 +1,55 @@
+#include "password_kdf.hpp"
+
+#include <gtest/gtest.h>
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+
+namespace bios_config_pwd::test
+{
+
+/** @brief Whether a password can be hashed with the parameters.
+ */
+static bool derives(const KdfParams& params)
+{
+    std::array<uint8_t, 32> seed{};
+    std::array<uint8_t, 64> hash{};
+    return deriveKey(params, "password", seed, hash);
+}
+
+TEST(PasswordKdfTest, ScryptStaysWithinTheMemoryLimit)
+{
+    // Any N fits the budget, the memory limit stops the calibration
+    auto params = calibrate("SCRYPT", std::chrono::hours(1));
+    EXPECT_EQ(params.iterations, scryptParallelism);
+    EXPECT_GE(params.memoryCost, 1024);
+    EXPECT_TRUE(derives(params));
+
+    params.memoryCost *= 2;
+    EXPECT_FALSE(derives(params));
+}
+
+TEST(PasswordKdfTest, ScryptSmallBudgetKeepsTheMinimum)
+{
+    auto params = calibrate("SCRYPT", std::chrono::milliseconds(0));
+    EXPECT_EQ(params.memoryCost, 1024);
+    EXPECT_TRUE(derives(params));
+}
+
+TEST(PasswordKdfTest, Pbkdf2StaysWithinTheIterationLimit)
+{
+    auto params = calibrate("SHA256", std::chrono::hours(24 * 365));
+    EXPECT_EQ(params.algorithm, "SHA256");
+    EXPECT_LE(params.iterations, maxIterations);
+    EXPECT_EQ(params.iterations % iterValue, 0);
+}
+
+TEST(PasswordKdfTest, Pbkdf2FitsTheBudget)
+{
+    auto params = calibrate("SHA256", std::chrono::milliseconds(20));
+    EXPECT_GE(params.iterations, iterValue);
+    EXPECT_TRUE(derives(params));
+}
+
+} // namespace bios_config_pwd::test
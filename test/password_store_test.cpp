@@ -0,0 +1,162 @@
+#include "daemon.hpp"
+#include "file_writer.hpp"
+#include "password.hpp"
+#include "password_store.hpp"
+
+#include <unistd.h>
+
+#include <gtest/gtest.h>
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+namespace bios_config_pwd::test
+{
+
+/** @brief Seed data with zero hashes and seed, using an algorithm.
+ */
+static nlohmann::json seedData(const std::string& algorithm)
+{
+    return {{"UserPwdHash", Hash{}},
+            {"AdminPwdHash", Hash{}},
+            {"Seed", Seed{}},
+            {"HashAlgo", algorithm}};
+}
+
+TEST(PasswordStoreTest, Pbkdf2DefaultsToIterValue)
+{
+    auto record = password_store::fromJson(seedData("SHA256"));
+    EXPECT_EQ(record.params.userKdf, (KdfParams{"SHA256", iterValue, 0}));
+    EXPECT_EQ(record.params.adminKdf, record.params.userKdf);
+}
+
+TEST(PasswordStoreTest, ScryptDefaultsToParallelismOfOne)
+{
+    auto document = seedData("SCRYPT");
+    document["MemoryCost"] = 1024;
+    auto record = password_store::fromJson(document);
+    EXPECT_EQ(record.params.userKdf, (KdfParams{"SCRYPT", 1, 1024}));
+}
+
+TEST(PasswordStoreTest, OtherAlgorithmDoesNotInheritIterations)
+{
+    auto document = seedData("SHA256");
+    document["Iterations"] = 5000;
+    document["AdminPwdKdf"] = {{"HashAlgo", "SCRYPT"}, {"MemoryCost", 1024}};
+    document["UserPwdKdf"] = {{"HashAlgo", "SHA512"}};
+    auto record = password_store::fromJson(document);
+    EXPECT_EQ(record.params.adminKdf, (KdfParams{"SCRYPT", 1, 1024}));
+    EXPECT_EQ(record.params.userKdf, (KdfParams{"SHA512", iterValue, 0}));
+}
+
+TEST(PasswordStoreTest, RejectsIterationsAboveInt)
+{
+    auto document = seedData("SHA256");
+    document["Iterations"] = uint32_t{maxIterations} + 1;
+    EXPECT_THROW(password_store::fromJson(document), std::runtime_error);
+
+    document["Iterations"] = maxIterations;
+    EXPECT_NO_THROW(password_store::fromJson(document));
+}
+
+TEST(PasswordStoreTest, DeriveKeyRejectsIterationsAboveInt)
+{
+    std::array<uint8_t, 32> seed{};
+    std::array<uint8_t, 64> hash{};
+    KdfParams params{"SHA256", uint32_t{maxIterations} + 1, 0};
+    EXPECT_FALSE(deriveKey(params, "password", seed, hash));
+
+    params.iterations = iterValue;
+    EXPECT_TRUE(deriveKey(params, "password", seed, hash));
+}
+
+TEST(PasswordStoreTest, RecordRoundTrips)
+{
+    auto document = seedData("SCRYPT");
+    document["MemoryCost"] = 2048;
+    document["IsAdminPwdChanged"] = true;
+    auto record = password_store::fromJson(document);
+    EXPECT_EQ(password_store::decode(password_store::encode(record)), record);
+}
+
+TEST(PasswordStoreTest, ToJsonKeepsOtherFields)
+{
+    auto document = seedData("SHA256");
+    document["Iterations"] = 5000;
+    document["Provisioned"] = "by the BIOS";
+    auto record = password_store::fromJson(document);
+
+    record.params.adminPwdHash[0] = 1;
+    record.params.adminKdf = {"SCRYPT", 1, 1024};
+    record.isAdminPwdChanged = true;
+    password_store::toJson(record, document);
+
+    EXPECT_EQ(document["Provisioned"], "by the BIOS");
+    EXPECT_EQ(document["Iterations"], 5000);
+    EXPECT_FALSE(document.contains("UserPwdKdf"));
+    EXPECT_TRUE(document.contains("AdminPwdKdf"));
+    EXPECT_EQ(password_store::fromJson(document), record);
+}
+
+class PasswordTest : public testing::Test
+{
+  protected:
+    PasswordTest() :
+        dir(std::filesystem::temp_directory_path() /
+            ("biosconfig-password-" + std::to_string(getpid())))
+    {
+        std::filesystem::remove_all(dir);
+        std::filesystem::create_directories(dir);
+    }
+
+    ~PasswordTest() override
+    {
+        std::filesystem::remove_all(dir);
+    }
+
+    /** @brief Start the password service on the directory and write out
+     *         what it changed at startup.
+     */
+    void start()
+    {
+        bios_config::test::PeerBus bus;
+        bios_config::PersistScheduler scheduler(
+            bus.io, *bus.objectServer, std::chrono::hours(1), 256,
+            *bus.metrics);
+        Password password(*bus.objectServer, bus.connection, dir.string(),
+                          scheduler, *bus.metrics);
+        scheduler.sync();
+        bus.drain();
+    }
+
+    std::filesystem::path dir;
+};
+
+TEST_F(PasswordTest, SeedFileIsKeptAndCached)
+{
+    auto document = seedData("SHA256");
+    document["Provisioned"] = "by the BIOS";
+    auto seedFile = dir / biosSeedFile;
+    ASSERT_TRUE(bios_config::FileWriter::replaceFile(seedFile,
+                                                     document.dump(4)));
+
+    start();
+
+    // Other daemons read the file, it stays as they wrote it
+    std::ifstream is(seedFile);
+    EXPECT_EQ(nlohmann::json::parse(is), document);
+
+    std::ifstream store(dir / biosPasswordStoreFile, std::ios::binary);
+    std::string data((std::istreambuf_iterator<char>(store)),
+                     std::istreambuf_iterator<char>());
+    EXPECT_EQ(password_store::decode(data), password_store::fromJson(document));
+}
+
+} // namespace bios_config_pwd::test